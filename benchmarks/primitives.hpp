@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dispatch.h"
+#include "lattice.h"
+#include "philox.h"
+#include "proposals.h"
+#include "walk_node.h"
+#include "walk_tree.h"
+
+// Microbenchmarks of the lattice and saw-tree primitives, templated on the dimension and on the SIMD variant. Each
+// instruction set has its own translation unit which includes this file, is compiled with the corresponding flags and
+// registers the benchmarks for its dimensions (as for the kernels of the library, see src/simd).
+
+using namespace pivot;
+
+namespace {
+
+constexpr int warmup_factor = 10;
+constexpr int lattice_sites = 1 << 12;
+constexpr std::size_t num_operands = 1 << 10;
+
+// A walk of the given number of sites, after warmup_factor pivot attempts per site. Built once per instantiation and
+// size, since building it takes much longer than most benchmarks.
+template <int Dim, bool Simd> walk_tree<Dim, Simd> &get_walk(int num_sites) {
+  static std::map<int, std::unique_ptr<walk_tree<Dim, Simd>>> walks;
+  auto &w = walks[num_sites];
+  if (!w) {
+    w = std::make_unique<walk_tree<Dim, Simd>>(num_sites, 42);
+    for (int i = 0; i < warmup_factor * num_sites; ++i) {
+      w->rand_pivot();
+    }
+  }
+  return *w;
+}
+
+// Operands of the lattice benchmarks: random transforms, and the endpoints and boxes of random nodes of a walk.
+template <int Dim, bool Simd> struct lattice_operands {
+  std::vector<transform<Dim, Simd>> transforms;
+  std::vector<point<Dim, Simd>> points;
+  std::vector<box<Dim, Simd>> boxes;
+};
+
+template <int Dim, bool Simd> const lattice_operands<Dim, Simd> &get_lattice_operands() {
+  static auto data = [] {
+    lattice_operands<Dim, Simd> data;
+    auto &w = get_walk<Dim, Simd>(lattice_sites);
+    philox gen(42);
+    std::uniform_int_distribution<int> dist(1, lattice_sites - 1);
+    for (std::size_t i = 0; i < num_operands; ++i) {
+      data.transforms.push_back(transform<Dim, Simd>::rand(gen));
+      data.points.push_back(w.find_node(dist(gen)).endpoint());
+      data.boxes.push_back(w.find_node(dist(gen)).bbox());
+    }
+    return data;
+  }();
+  return data;
+}
+
+// Random ids of internal nodes, or random pivot proposals, for a walk of the given number of sites.
+std::vector<int> rand_ids(int num_sites) {
+  philox gen(42);
+  std::uniform_int_distribution<int> dist(1, num_sites - 1);
+  std::vector<int> ids(num_operands);
+  for (auto &id : ids) {
+    id = dist(gen);
+  }
+  return ids;
+}
+
+// Skips the benchmark if its SIMD kernels cannot run on this CPU. Must be checked before any operand is built.
+template <int Dim, bool Simd> bool skip_unsupported(benchmark::State &state) {
+  if (Simd && !simd_supported(Dim)) {
+    state.SkipWithError("SIMD kernels not supported by this CPU");
+    return true;
+  }
+  return false;
+}
+
+} // namespace
+
+/* LATTICE */
+
+/** @brief Time taken by transform::operator* on a point. */
+template <int Dim, bool Simd> void BM_TransformPoint(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  const auto &data = get_lattice_operands<Dim, Simd>();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.transforms[i] * data.points[i]);
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by transform::operator* on a box. */
+template <int Dim, bool Simd> void BM_TransformBox(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  const auto &data = get_lattice_operands<Dim, Simd>();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.transforms[i] * data.boxes[i]);
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by transform::operator* on a transform. */
+template <int Dim, bool Simd> void BM_TransformTransform(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  const auto &data = get_lattice_operands<Dim, Simd>();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.transforms[i] * data.transforms[(i + 1) % num_operands]);
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by box::operator|, i.e. the bounding box of two boxes. */
+template <int Dim, bool Simd> void BM_BoxUnion(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  const auto &data = get_lattice_operands<Dim, Simd>();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.boxes[i] | data.boxes[(i + 1) % num_operands]);
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by box::operator&, i.e. the intersection of two boxes. */
+template <int Dim, bool Simd> void BM_BoxIntersection(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  const auto &data = get_lattice_operands<Dim, Simd>();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(data.boxes[i] & data.boxes[(i + 1) % num_operands]);
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken to draw a pivot proposal from its own Philox stream, one proposal at a time. */
+template <int Dim, bool Simd> void BM_DrawProposal(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  proposal_streams streams(42);
+  std::uniform_int_distribution<int> dist(1, lattice_sites - 1);
+  for (auto _ : state) {
+    auto gen = streams.next();
+    auto site = dist(gen);
+    benchmark::DoNotOptimize(proposal_draw<Dim, Simd>{site, transform<Dim, Simd>::rand(gen)});
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken to draw a pivot proposal from a proposal_queue, which draws them in batches. */
+template <int Dim, bool Simd> void BM_ProposalQueue(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto queue = std::make_unique<proposal_queue<Dim, Simd>>(proposal_streams(42), 1, lattice_sites - 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(queue->next());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/* SAW-TREE (the argument is the number of sites of the walk) */
+
+/** @brief Time taken by walk_node::merge at random internal nodes. */
+template <int Dim, bool Simd> void BM_Merge(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto num_sites = static_cast<int>(state.range(0));
+  auto &w = get_walk<Dim, Simd>(num_sites);
+  auto ids = rand_ids(num_sites);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    w.find_node(ids[i]).merge();
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_node::rotate_left followed by the walk_node::rotate_right undoing it, at the root. */
+template <int Dim, bool Simd> void BM_RotateLeftRight(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto root = get_walk<Dim, Simd>(static_cast<int>(state.range(0))).root();
+  for (auto _ : state) {
+    root->rotate_left();
+    root->rotate_right();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_node::shuffle_up to a random node followed by walk_node::shuffle_down, at the root. */
+template <int Dim, bool Simd> void BM_ShuffleUpDown(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto num_sites = static_cast<int>(state.range(0));
+  auto root = get_walk<Dim, Simd>(num_sites).root();
+  auto ids = rand_ids(num_sites);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    root->shuffle_up(ids[i]);
+    root->shuffle_down();
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_node::shuffle_intersect to test random pivots, accepted or not. */
+template <int Dim, bool Simd> void BM_ShuffleIntersect(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto num_sites = static_cast<int>(state.range(0));
+  auto &w = get_walk<Dim, Simd>(num_sites);
+  auto ids = rand_ids(num_sites);
+  std::vector<transform<Dim, Simd>> transforms;
+  philox gen(42);
+  for (std::size_t i = 0; i < num_operands; ++i) {
+    transforms.push_back(transform<Dim, Simd>::rand(gen));
+  }
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(w.find_node(ids[i]).shuffle_intersect(transforms[i]));
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_node::intersect to check that the whole walk is self-avoiding. */
+template <int Dim, bool Simd> void BM_Intersect(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto root = get_walk<Dim, Simd>(static_cast<int>(state.range(0))).root();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(root->intersect());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_tree::site to find a random site of the walk. */
+template <int Dim, bool Simd> void BM_Site(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto num_sites = static_cast<int>(state.range(0));
+  const auto &w = get_walk<Dim, Simd>(num_sites);
+  auto ids = rand_ids(num_sites);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(w.site(ids[i]));
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_tree::bbox to find the bounding box of a random range of sites of the walk. */
+template <int Dim, bool Simd> void BM_Bbox(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto num_sites = static_cast<int>(state.range(0));
+  const auto &w = get_walk<Dim, Simd>(num_sites);
+  auto ids = rand_ids(num_sites);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    auto [first, last] = std::minmax(ids[i], ids[(i + 1) % num_operands]);
+    benchmark::DoNotOptimize(w.bbox(first - 1, last));
+    i = (i + 1) % num_operands;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/** @brief Time taken by walk_node::balanced_rep to build the saw-tree of a walk, per site. */
+template <int Dim, bool Simd> void BM_BalancedRep(benchmark::State &state) {
+  if (skip_unsupported<Dim, Simd>(state)) {
+    return;
+  }
+  auto num_sites = static_cast<int>(state.range(0));
+  auto steps = get_walk<Dim, Simd>(num_sites).steps();
+  auto num_slots = walk_node<Dim, Simd>::num_slots(num_sites, 1);
+  constexpr auto alignment = std::align_val_t(alignof(walk_node<Dim, Simd>));
+  auto buf = static_cast<walk_node<Dim, Simd> *>(::operator new[](sizeof(walk_node<Dim, Simd>) * num_slots, alignment));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(walk_node<Dim, Simd>::balanced_rep(steps, buf));
+    state.PauseTiming();
+    std::destroy_n(buf, num_slots);
+    state.ResumeTiming();
+  }
+  ::operator delete[](buf, alignment);
+  state.SetItemsProcessed(state.iterations() * num_sites);
+}
+
+
+#define LATTICE_BENCH(z, n, simd)                                                                                      \
+  BENCHMARK(BM_TransformPoint<n, simd>);                                                                               \
+  BENCHMARK(BM_TransformBox<n, simd>);                                                                                 \
+  BENCHMARK(BM_TransformTransform<n, simd>);                                                                           \
+  BENCHMARK(BM_BoxUnion<n, simd>);                                                                                     \
+  BENCHMARK(BM_BoxIntersection<n, simd>);                                                                              \
+  BENCHMARK(BM_DrawProposal<n, simd>);                                                                                 \
+  BENCHMARK(BM_ProposalQueue<n, simd>);
+
+#define TREE_BENCH_SIZES RangeMultiplier(16)->Range(1 << 8, 1 << 16)
+
+#define TREE_BENCH(z, n, simd)                                                                                         \
+  BENCHMARK(BM_Merge<n, simd>)->TREE_BENCH_SIZES;                                                                      \
+  BENCHMARK(BM_RotateLeftRight<n, simd>)->TREE_BENCH_SIZES;                                                            \
+  BENCHMARK(BM_ShuffleUpDown<n, simd>)->TREE_BENCH_SIZES;                                                              \
+  BENCHMARK(BM_ShuffleIntersect<n, simd>)->TREE_BENCH_SIZES->Unit(benchmark::kMicrosecond);                            \
+  BENCHMARK(BM_Intersect<n, simd>)->TREE_BENCH_SIZES->Unit(benchmark::kMicrosecond);                                   \
+  BENCHMARK(BM_Site<n, simd>)->TREE_BENCH_SIZES;                                                                       \
+  BENCHMARK(BM_Bbox<n, simd>)->TREE_BENCH_SIZES;                                                                       \
+  BENCHMARK(BM_BalancedRep<n, simd>)->TREE_BENCH_SIZES->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,8 @@
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+
+#include "lattice_simd.h"
+
+#include "primitives.hpp"
+
+BOOST_PP_REPEAT_FROM_TO(AVX2_DIMS_UB, SIMD_DIMS_UB, LATTICE_BENCH, true)
+BOOST_PP_REPEAT_FROM_TO(AVX2_DIMS_UB, SIMD_DIMS_UB, TREE_BENCH, true)
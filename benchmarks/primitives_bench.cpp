@@ -0,0 +1,6 @@
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+
+#include "primitives.hpp"
+
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, LATTICE_BENCH, false)
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, TREE_BENCH, false)
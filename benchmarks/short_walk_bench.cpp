@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+
+#include "occupancy.h"
+#include "walk.h"
+#include "walk_tree.h"
+
+using namespace pivot;
+
+namespace {
+
+template <int Dim> using hash_walk = walk<Dim>;
+template <int Dim> using grid_walk = walk<Dim, false, grid_occupancy<Dim>>;
+
+} // namespace
+
+/** @brief Time taken by a pivot attempt on a short walk, after a warm-up period of 20 attempts per site. */
+template <class Walk> void BM_RandPivot(benchmark::State &state) {
+  auto num_sites = static_cast<int>(state.range(0));
+  Walk w(num_sites, 42);
+  for (int i = 0; i < 20 * num_sites; ++i) {
+    w.rand_pivot(true);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(w.rand_pivot(true));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_RandPivot<hash_walk<2>>)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RandPivot<grid_walk<2>>)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RandPivot<walk_tree<2>>)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RandPivot<hash_walk<3>>)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RandPivot<grid_walk<3>>)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RandPivot<walk_tree<3>>)->RangeMultiplier(4)->Range(64, 4096)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,71 @@
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "dispatch.h"
+#include "lattice.h"
+#include "philox.h"
+#include "walk_node.h"
+#include "walk_tree.h"
+
+// Benchmark of rejected pivots, templated on the dimension and on the SIMD variant. As for the primitives (see
+// primitives.hpp), each instruction set has its own translation unit which includes this file and registers the
+// benchmark for its variant.
+
+using namespace pivot;
+
+namespace {
+
+constexpr int num_sites = 10'000'000;
+constexpr int warmup_iters = 100'000;
+constexpr int num_proposals = 1 << 12;
+
+template <int Dim, bool Simd> struct rejected_proposals {
+  std::unique_ptr<walk_tree<Dim, Simd>> walk;
+  std::vector<std::pair<int, transform<Dim, Simd>>> proposals;
+};
+
+// A walk of num_sites sites, pivoted away from a straight line, along with random pivots that it rejects. Built once
+// per instantiation, since building it takes much longer than the benchmark itself.
+template <int Dim, bool Simd> const rejected_proposals<Dim, Simd> &get_rejected_proposals() {
+  static auto data = [] {
+    rejected_proposals<Dim, Simd> data;
+    data.walk = std::make_unique<walk_tree<Dim, Simd>>(num_sites, 42);
+    for (int i = 0; i < warmup_iters; ++i) {
+      data.walk->rand_pivot();
+    }
+
+    philox gen(42);
+    std::uniform_int_distribution<int> dist(1, num_sites - 1);
+    while (data.proposals.size() < num_proposals) {
+      auto n = dist(gen);
+      auto t = transform<Dim, Simd>::rand(gen);
+      if (!t.is_identity() && data.walk->find_node(n).shuffle_intersect(t)) {
+        data.proposals.emplace_back(n, t);
+      }
+    }
+    return data;
+  }();
+  return data;
+}
+
+} // namespace
+
+/** @brief Time taken by Attempt_pivot_fast to reject a pivot, i.e. to find an intersection. */
+template <int Dim, bool Simd> void BM_ShuffleIntersectRejected(benchmark::State &state) {
+  if (Simd && !simd_supported(Dim)) {
+    state.SkipWithError("SIMD kernels not supported by this CPU");
+    return;
+  }
+  const auto &data = get_rejected_proposals<Dim, Simd>();
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const auto &[n, t] = data.proposals[i];
+    benchmark::DoNotOptimize(data.walk->find_node(n).shuffle_intersect(t));
+    i = (i + 1) % data.proposals.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
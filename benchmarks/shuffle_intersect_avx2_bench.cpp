@@ -0,0 +1,6 @@
+#include "lattice_simd.h"
+
+#include "shuffle_intersect.hpp"
+
+BENCHMARK(BM_ShuffleIntersectRejected<2, true>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ShuffleIntersectRejected<3, true>)->Unit(benchmark::kMicrosecond);
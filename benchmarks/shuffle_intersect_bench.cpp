@@ -0,0 +1,4 @@
+#include "shuffle_intersect.hpp"
+
+BENCHMARK(BM_ShuffleIntersectRejected<2, false>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ShuffleIntersectRejected<3, false>)->Unit(benchmark::kMicrosecond);
@@ -6,11 +6,17 @@ import subprocess
 import time
 from pathlib import Path
 
-WARM_UP_FACTOR = 20
+# walks start pseudo-dimerized (see --dimerize), which leaves much less to warm up than a straight line
+WARM_UP_FACTOR = 2
 BENCH_ITERS = 1_000_000
+SIMD_DIMS = (2, 3, 4)
 
 DEFAULT_PIVOT_PATH = Path(__file__).parent.parent / "build" / "pivot"
 pivot_path = os.getenv("PIVOT_PATH", DEFAULT_PIVOT_PATH)
+DEFAULT_PIVOT_BENCH_PATH = Path(__file__).parent.parent / "build" / "benchmarks" / "pivot_bench"
+pivot_bench_path = os.getenv("PIVOT_BENCH_PATH", DEFAULT_PIVOT_BENCH_PATH)
+# the benchmarks of the SIMD types are built as executables of their own, next to pivot_bench
+SIMD_BENCH_SUFFIXES = ("_avx2", "_avx512")
 
 
 def _steps(max_power):
@@ -27,8 +33,8 @@ def warmup(dim: int, max_power: int, seed: int | None = None):
         out_dir = Path(__file__).parent / "benchmark" / f"dim_{dim}" / f"warmup_{steps}"
         out_dir.mkdir(parents=True, exist_ok=True)
 
-        cmd = f"{pivot_path} -d {dim} -s {steps} -i {warm_up_iters} --out {out_dir} "
-        if dim == 2:
+        cmd = f"{pivot_path} -d {dim} -s {steps} -i {warm_up_iters} --dimerize --out {out_dir} "
+        if dim in SIMD_DIMS:
             cmd += "--simd "
         if seed is not None:
             cmd += f"--seed {seed}"
@@ -47,6 +53,8 @@ def benchmark(
     ):
     if naive:
         slow = True
+    if simd and dim not in SIMD_DIMS:
+        raise ValueError(f"SIMD is only supported in dimensions {SIMD_DIMS}")
     print(f"Running benchmark for dimension {dim}")
     times = {}
     steps_list = _steps(max_power)
@@ -62,7 +70,7 @@ def benchmark(
             f"--in {in_dir} "
             f"--{'slow' if slow else 'fast'} "
             f"{'--naive' if naive else ''} "
-            f"{'--simd' if simd else ''} "
+            f"{'--simd' if simd else '--no-simd'} "
         )
         if seed is not None:
             cmd += f"--seed {seed}"
@@ -83,6 +91,35 @@ def benchmark(
         json.dump(times, f)
     print(f"Times saved to {out}")
 
+def micro(dim: int, out: str, bench_filter: str = ""):
+    """Runs the microbenchmarks in the given dimension and saves microseconds per iteration by benchmark name."""
+    # benchmark names start with BM_<operation><Dim, Simd>
+    name_filter = f"<{dim}, "
+    if bench_filter:
+        name_filter = f"{bench_filter}.*{name_filter}"
+    bench_paths = [Path(pivot_bench_path)]
+    bench_paths += [p for p in (Path(f"{pivot_bench_path}{suffix}") for suffix in SIMD_BENCH_SUFFIXES) if p.exists()]
+    print(f"Running microbenchmarks for dimension {dim}")
+
+    unit_scale = {"ns": 1e-3, "us": 1.0, "ms": 1e3, "s": 1e6}
+    times = {}
+    for bench_path in bench_paths:
+        cmd = [str(bench_path), "--benchmark_format=json", f"--benchmark_filter={name_filter}"]
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, check=True)
+        # nothing is written when no benchmark of the executable matches the filter
+        if not proc.stdout.strip():
+            continue
+        for run in json.loads(proc.stdout)["benchmarks"]:
+            if run.get("error_occurred") or run.get("run_type", "iteration") != "iteration":
+                continue
+            times[run["name"]] = run["real_time"] * unit_scale[run["time_unit"]]
+            print(f"{run['name']}: {times[run['name']]:.4f} µs")
+
+    Path(out).parent.mkdir(parents=True, exist_ok=True)
+    with open(out, "w") as f:
+        json.dump(times, f)
+    print(f"Times saved to {out}")
+
 def analyze(dim, out, **kwargs):
     times = {}
     for name, path in kwargs.items():
@@ -118,6 +155,10 @@ if __name__ == "__main__":
     benchmark_parser.add_argument("--seed", default=None)
     benchmark_parser.add_argument("--naive", default=False, action="store_true")
 
+    micro_parser = subparsers.add_parser("micro")
+    micro_parser.add_argument("--out", default="micro.json")
+    micro_parser.add_argument("--filter", default="")
+
     analyze_parser = subparsers.add_parser("analyze")
     analyze_parser.add_argument("--out", default="benchmark.png")
 
@@ -130,6 +171,10 @@ if __name__ == "__main__":
         if extra:
             raise ValueError(f"Unrecognized arguments for benchmark: {extra}")
         benchmark(args.dim, args.out, args.slow, args.max_power, naive=args.naive, simd=args.simd, seed=args.seed)
+    elif args.command == "micro":
+        if extra:
+            raise ValueError(f"Unrecognized arguments for micro: {extra}")
+        micro(args.dim, args.out, args.filter)
     elif args.command == "analyze":
         extra_dict = {}
         for i in range(0, len(extra), 2):
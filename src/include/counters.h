@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace pivot {
+
+/**
+ * @brief Counts of the work done by the saw-tree primitives, to tell where pivot attempts spend their time.
+ *
+ * @details The primitives only update the counters if the library is built with ENABLE_COUNTERS (the COUNTERS CMake
+ * option), through the PIVOT_COUNT macro, which otherwise expands to nothing. Each thread updates its own counters (see
+ * thread_counters), which are summed by collect_counters.
+ */
+struct counters {
+  /** @brief Largest level at which collisions are told apart, larger ones being counted with it. */
+  static constexpr int max_level = 63;
+
+  std::uint64_t intersect_calls{};  // searches started by intersect, including those of shuffle_intersect
+  std::uint64_t nodes_visited{};    // steps of the searches, each of which splits a node or compares two leaves
+  std::uint64_t box_tests{};        // intersection tests between the boxes of two subwalks
+  std::uint64_t leaf_tests{};       // pairs of leaves compared site by site
+  int max_depth{};                  // largest number of splits from the subwalks a search of intersect started from
+  std::uint64_t shuffle_tests{};    // calls to shuffle_intersect
+  std::uint64_t merges{};           // calls to walk_node::merge
+  std::uint64_t rotations{};        // left and right rotations
+  std::uint64_t commits{};          // pivots applied to a saw-tree
+
+  // collisions found by shuffle_intersect, by the number of ancestors of the pivot node visited before finding them
+  std::array<std::uint64_t, max_level + 1> collision_levels{};
+
+  counters &operator+=(const counters &c);
+
+  /** @brief Returns the counters as a JSON object on a single line, with the rotations per commit. */
+  std::string to_json() const;
+};
+
+/**
+ * @brief Returns the counters of the calling thread.
+ *
+ * Primitives should look them up once per call rather than once per update, as accessing them involves a check that
+ * the thread's counters have been registered.
+ */
+counters &thread_counters();
+
+/**
+ * @brief Returns the sum of the counters of all threads (including those which have exited) and resets them.
+ *
+ * @warning Must not be called while other threads may update their counters, e.g. during a call to
+ * walk_tree::rand_pivot. Threads that are merely waiting, such as idle workers of a walk_tree, are fine.
+ */
+counters collect_counters();
+
+} // namespace pivot
+
+#ifdef ENABLE_COUNTERS
+#define PIVOT_COUNT(...) __VA_ARGS__
+#else
+#define PIVOT_COUNT(...)
+#endif
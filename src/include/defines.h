@@ -3,3 +3,11 @@
 #ifndef DIMS_UB
 #define DIMS_UB 6
 #endif
+
+// Exclusive upper bounds on the dimensions with SIMD specializations (see lattice_simd.h and src/simd)
+#define AVX2_DIMS_UB 5
+#ifdef ENABLE_AVX512
+#define SIMD_DIMS_UB 9
+#else
+#define SIMD_DIMS_UB AVX2_DIMS_UB
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "lattice.h"
+
+namespace pivot {
+
+/**
+ * @brief Returns the sites of a self-avoiding walk on the given number of sites, close to uniformly distributed, built
+ * by Clisby's pseudo-dimerization.
+ *
+ * @details Walks of up to 16 sites are grown as non-reversing random walks, restarted whenever they hit themselves,
+ * which yields exactly uniform self-avoiding walks. Longer walks are made of two halves, built recursively, which are
+ * joined by a uniformly random symmetry of the lattice, i.e. by a pivot about the joint. Unlike in dimerization,
+ * where both halves are discarded whenever the join is not self-avoiding, failed joins are repaired by pivots about
+ * sites of the halves near the joint, which only move the few sites between them and the joint. This keeps the cost
+ * linear in the number of sites per level of the recursion, whereas dimerization grows faster than the number of
+ * sites, at the price of a bias towards compact walks, whose halves fail more joins. The walk thus starts much closer
+ * to equilibrium than a straight line, but still needs about one pivot attempt per site before sampling.
+ *
+ * The halves of the top levels of the recursion are built by separate threads. Each half draws from its own philox
+ * stream of the seed, chosen by the half it is part of, so the walk only depends on the seed and not on the number of
+ * threads. The streams used are disjoint from those of pivot proposals (see proposal_streams), so the walk can use the
+ * same seed for pivoting.
+ *
+ * @param num_sites Number of lattice sites. Must be at least 2 (single step).
+ * @param seed Random seed.
+ * @param num_workers Number of threads building halves, including the calling thread.
+ *
+ * @return Sites of the walk, the first of which is point::unit(0) as for line.
+ */
+template <int Dim, bool Simd>
+std::vector<point<Dim, Simd>> pseudo_dimerize(int num_sites, std::uint64_t seed, int num_workers = 1);
+
+} // namespace pivot
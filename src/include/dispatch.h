@@ -0,0 +1,15 @@
+#pragma once
+
+namespace pivot {
+
+/**
+ * @brief Returns whether SIMD kernels for the given dimension are included in this build and supported by the CPU.
+ *
+ * Kernels in dimensions 2 to 4 require AVX2 and kernels in dimensions 5 to 8 require AVX-512 (F and VL).
+ */
+bool simd_supported(int dim);
+
+/** @brief Returns whether SIMD kernels for the given dimension are included in this build. */
+bool simd_built(int dim);
+
+} // namespace pivot
@@ -1,15 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <limits>
 #include <random>
 #include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/operators.hpp>
 
 #include "defines.h"
+#include "philox.h"
 
 namespace pivot {
 
@@ -127,6 +131,9 @@ template <int Dim, bool Simd = false> struct box : boost::additive<box<Dim, Simd
    */
   box operator&(const box &b) const;
 
+  /** @brief Returns whether the box is disjoint from each of two other boxes. */
+  std::array<bool, 2> disjoint(const box &b1, const box &b2) const;
+
   /** @brief Returns the string of the form "{intervals_[0]} x ... x {intervals[Dim - 1]}". */
   std::string to_string() const;
 };
@@ -143,6 +150,49 @@ struct point_hash {
   template <int Dim, bool Simd = false> std::size_t operator()(const point<Dim, Simd> &p) const;
 };
 
+/**
+ * @brief Draws a uniformly random permutation of {0, ..., Dim - 1} and signs, i.e. an element of the symmetry group of
+ * the cubic lattice (see transform).
+ *
+ * @details If the order 2^Dim Dim! of the group fits in 64 bits, a single index in the group is drawn, which takes a
+ * single call of a 64-bit engine such as philox. Its lowest Dim bits give the signs and the rest, as digits in the
+ * factorial number system, the swaps of a Fisher-Yates shuffle. Otherwise, the signs and the shuffle are drawn apart.
+ */
+template <int Dim, typename Gen>
+void rand_signed_perm(Gen &gen, std::array<int, Dim> &perm, std::array<int, Dim> &signs) {
+  constexpr std::uint64_t order = [] {
+    std::uint64_t n = 1;
+    for (int i = 1; i <= Dim; ++i) {
+      if (n > std::numeric_limits<std::uint64_t>::max() / (2 * i)) {
+        return std::uint64_t{0};
+      }
+      n *= 2 * i;
+    }
+    return n;
+  }();
+
+  for (int i = 0; i < Dim; ++i) {
+    perm[i] = i;
+  }
+  if constexpr (order > 0) {
+    auto index = std::uniform_int_distribution<std::uint64_t>(0, order - 1)(gen);
+    for (int i = 0; i < Dim; ++i) {
+      signs[i] = (index >> i & 1) ? -1 : 1;
+    }
+    index >>= Dim;
+    for (int i = Dim; i > 1; --i) {
+      std::swap(perm[i - 1], perm[index % i]);
+      index /= i;
+    }
+  } else {
+    std::bernoulli_distribution flip;
+    for (int i = 0; i < Dim; ++i) {
+      signs[i] = 2 * flip(gen) - 1;
+    }
+    std::shuffle(perm.begin(), perm.end(), gen);
+  }
+}
+
 /**
  * @brief Represents a transformation from the symmetry group of the cubic lattice.
  *
@@ -180,15 +230,9 @@ public:
 
   /** @brief Produce a uniformly random transfom.*/
   template <typename Gen> static transform rand(Gen &gen) {
-    static std::bernoulli_distribution flip_;
-
     std::array<int, Dim> perm;
     std::array<int, Dim> signs;
-    for (int i = 0; i < Dim; ++i) {
-      perm[i] = i;
-      signs[i] = 2 * flip_(gen) - 1;
-    }
-    std::shuffle(perm.begin(), perm.end(), gen);
+    rand_signed_perm<Dim>(gen, perm, signs);
     return transform(perm, signs);
   }
 
@@ -286,4 +330,60 @@ private:
   std::array<int, Dim> signs_;
 };
 
+/** @brief Exclusive upper bound on the dimensions in which non-SIMD transforms are represented by group indices. */
+constexpr int transform_table_dims_ub = 5;
+
+/**
+ * @brief Represents a transformation from the symmetry group of the cubic lattice by its index in the group.
+ *
+ * In low dimensions the group is small (8 elements in 2D, 48 in 3D and 384 in 4D), so the permutation and signs of
+ * every element, as well as the group's multiplication table and inverses, are generated at compile time. Composition
+ * and inversion are then table lookups and a transform takes up only two bytes. Semantics are those of the generic
+ * transform.
+ *
+ * The element with permutation P and signs S has index 2^Dim r + s, where r is the lexicographic rank of P and the
+ * i-th bit of s is set if S(i) is negative. In particular, the identity has index 0.
+ */
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+class transform<Dim, false> {
+
+public:
+  transform();
+
+  transform(const std::array<int, Dim> &perm, const std::array<int, Dim> &signs);
+
+  transform(const point<Dim, false> &p, const point<Dim, false> &q);
+
+  template <typename Gen> static transform rand(Gen &gen) {
+    std::array<int, Dim> perm;
+    std::array<int, Dim> signs;
+    rand_signed_perm<Dim>(gen, perm, signs);
+    return transform(perm, signs);
+  }
+
+  static transform rand();
+
+  bool operator==(const transform &t) const;
+
+  point<Dim, false> operator*(const point<Dim, false> &p) const;
+
+  transform operator*(const transform &t) const;
+
+  box<Dim, false> operator*(const box<Dim, false> &b) const;
+
+  bool is_identity() const;
+
+  transform inverse() const;
+
+  std::array<std::array<int, Dim>, Dim> to_matrix() const;
+
+  std::string to_string() const;
+
+private:
+  std::uint16_t index_;
+
+  explicit transform(std::uint16_t index) : index_(index) {}
+};
+
 } // namespace pivot
@@ -1,8 +1,31 @@
 #pragma once
 
+#include <cstring>
+#include <numeric>
+
+#if defined(__AVX512F__) && !defined(__clang__)
+// GCC 12 reports the undefined registers used by many AVX-512 intrinsics as uninitialized (GCC bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
 #include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
 
 #include "lattice.h"
+#include "philox.h"
+
+// The helpers below are compiled once for each instruction set with SIMD kernels (see src/simd), so they live in a
+// namespace per instruction set to keep the linker from mixing up copies compiled with different flags.
+#ifdef __AVX512F__
+inline namespace avx512 {
+#else
+inline namespace avx2 {
+#endif
 
 static inline uint32_t extract_epi32(__m128i data, size_t i) {
   switch (i) {
@@ -48,6 +71,191 @@ inline __m128i sort_bounds(__m128i pairs) {
   return _mm_blend_epi32(minima, maxima, 0b1100);
 }
 
+/* Width-generic helpers for the specializations in dimensions 3 and higher */
+
+/** @brief Integer register with the given number of 32-bit lanes. */
+template <int Lanes> struct simd_int;
+
+template <> struct simd_int<4> {
+  using type = __m128i;
+};
+
+template <> struct simd_int<8> {
+  using type = __m256i;
+};
+
+template <> struct simd_int<16> {
+  using type = __m512i;
+};
+
+// Vector types lose their attributes when used as template arguments, so registers are named by their lane counts
+template <int Lanes> using simd_int_t = typename simd_int<Lanes>::type;
+
+// Loads values into the lower lanes of a register and fill into the remaining lanes.
+template <int Lanes, std::size_t N> inline simd_int_t<Lanes> load_epi32(const std::array<int, N> &values, int fill = 0) {
+  static_assert(N <= Lanes);
+  std::array<int, Lanes> lanes;
+  lanes.fill(fill);
+  std::copy(values.begin(), values.end(), lanes.begin());
+  simd_int_t<Lanes> data;
+  std::memcpy(&data, lanes.data(), sizeof(data));
+  return data;
+}
+
+template <typename V> inline std::array<int, sizeof(V) / sizeof(int)> store_epi32(V data) {
+  std::array<int, sizeof(V) / sizeof(int)> lanes;
+  std::memcpy(lanes.data(), &data, sizeof(V));
+  return lanes;
+}
+
+template <int Lanes> inline simd_int_t<Lanes> set1_epi32(int a) {
+  if constexpr (Lanes == 4) {
+    return _mm_set1_epi32(a);
+  } else {
+    return _mm256_set1_epi32(a);
+  }
+}
+
+// Returns (0, 1, 2, ...)
+template <int Lanes> inline simd_int_t<Lanes> iota_epi32() {
+  std::array<int, Lanes> lanes;
+  std::iota(lanes.begin(), lanes.end(), 0);
+  return load_epi32<Lanes>(lanes);
+}
+
+inline __m128i add_epi32(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+inline __m256i add_epi32(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+
+inline __m128i sub_epi32(__m128i a, __m128i b) { return _mm_sub_epi32(a, b); }
+inline __m256i sub_epi32(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+
+inline __m128i mullo_epi32(__m128i a, __m128i b) { return _mm_mullo_epi32(a, b); }
+inline __m256i mullo_epi32(__m256i a, __m256i b) { return _mm256_mullo_epi32(a, b); }
+
+inline __m128i min_epi32(__m128i a, __m128i b) { return _mm_min_epi32(a, b); }
+inline __m256i min_epi32(__m256i a, __m256i b) { return _mm256_min_epi32(a, b); }
+
+inline __m128i max_epi32(__m128i a, __m128i b) { return _mm_max_epi32(a, b); }
+inline __m256i max_epi32(__m256i a, __m256i b) { return _mm256_max_epi32(a, b); }
+
+inline __m128i sign_epi32(__m128i a, __m128i b) { return _mm_sign_epi32(a, b); }
+inline __m256i sign_epi32(__m256i a, __m256i b) { return _mm256_sign_epi32(a, b); }
+
+inline __m128i cmpeq_epi32(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+inline __m256i cmpeq_epi32(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+
+inline __m128i and_si(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+inline __m256i and_si(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+
+inline __m128i or_si(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+inline __m256i or_si(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+
+inline __m256i permutevar_epi32(__m256i data, __m256i perm) { return _mm256_permutevar8x32_epi32(data, perm); }
+
+inline bool all_eq_epi32(__m128i a, __m128i b) { return _mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) == 0xFFFF; }
+inline bool all_eq_epi32(__m256i a, __m256i b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b)) == -1; }
+
+inline bool any_gt_epi32(__m128i a, __m128i b) {
+#ifdef __AVX512VL__
+  return _mm_cmpgt_epi32_mask(a, b) != 0;
+#else
+  __m128i cmp = _mm_cmpgt_epi32(a, b);
+  return !_mm_testz_si128(cmp, cmp);
+#endif
+}
+inline bool any_gt_epi32(__m256i a, __m256i b) {
+#ifdef __AVX512VL__
+  return _mm256_cmpgt_epi32_mask(a, b) != 0;
+#else
+  __m256i cmp = _mm256_cmpgt_epi32(a, b);
+  return !_mm256_testz_si256(cmp, cmp);
+#endif
+}
+
+// Returns the inverse of a permutation of the lanes of a register.
+template <typename V> inline V invert_permutation(V perm) {
+  constexpr int num_lanes = sizeof(V) / sizeof(int);
+  V lanes = iota_epi32<num_lanes>();
+  V inverse = set1_epi32<num_lanes>(0);
+  for (int i = 1; i < num_lanes; ++i) {
+    V image = permutevar_epi32(perm, set1_epi32<num_lanes>(i));
+    inverse = or_si(inverse, and_si(cmpeq_epi32(image, lanes), set1_epi32<num_lanes>(i)));
+  }
+  return inverse;
+}
+
+/*
+ * Helpers for boxes, which hold lower bounds in the lower half of a register and upper bounds in the upper half. Both
+ * halves are acted on by the same point or transform, which occupies a register of half the width.
+ */
+
+inline __m256i join_halves(__m128i lower, __m128i upper) { return _mm256_setr_m128i(lower, upper); }
+
+inline __m128i lower_half(__m256i data) { return _mm256_castsi256_si128(data); }
+
+inline __m128i upper_half(__m256i data) { return _mm256_extracti128_si256(data, 1); }
+
+inline __m256i broadcast_halves(__m128i data) { return _mm256_broadcastsi128_si256(data); }
+
+// Takes the lower half from lower and the upper half from upper.
+inline __m256i blend_halves(__m256i lower, __m256i upper) { return _mm256_blend_epi32(lower, upper, 0b11110000); }
+
+// Given possibly swapped bounds, returns the lower bounds in the lower half and the upper bounds in the upper half.
+inline __m256i sort_halves(__m256i pairs) {
+  __m256i swapped = _mm256_permute2x128_si256(pairs, pairs, 1);
+  return blend_halves(_mm256_min_epi32(pairs, swapped), _mm256_max_epi32(pairs, swapped));
+}
+
+// Applies the same permutation to both halves.
+inline __m256i permute_halves(__m256i data, __m128i perm) {
+  return _mm256_castps_si256(_mm256_permutevar_ps(_mm256_castsi256_ps(data), broadcast_halves(perm)));
+}
+
+inline __m256i sign_halves(__m256i data, __m128i signs) { return _mm256_sign_epi32(data, broadcast_halves(signs)); }
+
+#ifdef __AVX512F__
+inline __m512i add_epi32(__m512i a, __m512i b) { return _mm512_add_epi32(a, b); }
+
+inline __m512i sub_epi32(__m512i a, __m512i b) { return _mm512_sub_epi32(a, b); }
+
+inline __m512i min_epi32(__m512i a, __m512i b) { return _mm512_min_epi32(a, b); }
+
+inline __m512i max_epi32(__m512i a, __m512i b) { return _mm512_max_epi32(a, b); }
+
+inline bool all_eq_epi32(__m512i a, __m512i b) { return _mm512_cmpneq_epi32_mask(a, b) == 0; }
+
+inline __m512i join_halves(__m256i lower, __m256i upper) {
+  return _mm512_inserti64x4(_mm512_castsi256_si512(lower), upper, 1);
+}
+
+inline __m256i lower_half(__m512i data) { return _mm512_castsi512_si256(data); }
+
+inline __m256i upper_half(__m512i data) { return _mm512_extracti64x4_epi64(data, 1); }
+
+inline __m512i broadcast_halves(__m256i data) { return _mm512_broadcast_i64x4(data); }
+
+inline __m512i blend_halves(__m512i lower, __m512i upper) { return _mm512_mask_blend_epi32(0xFF00, lower, upper); }
+
+inline __m512i sort_halves(__m512i pairs) {
+  __m512i swapped = _mm512_shuffle_i64x2(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2));
+  return _mm512_mask_max_epi32(_mm512_min_epi32(pairs, swapped), 0xFF00, pairs, swapped);
+}
+
+inline __m512i permute_halves(__m512i data, __m256i perm) {
+  __m512i offsets = _mm512_maskz_set1_epi32(0xFF00, 8);
+  return _mm512_permutexvar_epi32(_mm512_add_epi32(broadcast_halves(perm), offsets), data);
+}
+
+// Negates the lanes whose sign is negative using a masked subtraction, since there is no 512-bit sign instruction.
+inline __m512i sign_halves(__m512i data, __m256i signs) {
+  __mmask16 negative = _mm256_cmplt_epi32_mask(signs, _mm256_setzero_si256());
+  negative |= negative << 8;
+  return _mm512_mask_sub_epi32(data, negative, _mm512_setzero_si512(), data);
+}
+#endif
+
+} // namespace avx2/avx512
+
 namespace pivot {
 
 template <> class point<2, true> : boost::multipliable<point<2, true>, int> {
@@ -117,6 +325,8 @@ template <> struct box<2, true> : boost::additive<box<2, true>, point<2, true>>
 
   box operator&(const box &b) const;
 
+  std::array<bool, 2> disjoint(const box &b1, const box &b2) const;
+
   std::string to_string() const;
 };
 
@@ -130,16 +340,9 @@ public:
   transform(const point<2, true> &p, const point<2, true> &q);
 
   template <typename Gen> static transform rand(Gen &gen) {
-    static std::bernoulli_distribution flip_;
-
     std::array<int, 2> perm;
     std::array<int, 2> signs;
-    for (int i = 0; i < 2; ++i) {
-      perm[i] = i;
-      signs[i] = 2 * flip_(gen) - 1;
-    }
-    std::shuffle(perm.begin(), perm.end(), gen);
-
+    rand_signed_perm<2>(gen, perm, signs);
     return transform(perm, signs);
   }
 
@@ -168,4 +371,158 @@ private:
   transform(__m128i perm, __m128i signs) : perm_(perm), signs_(signs) {}
 };
 
+/** @brief Number of lanes of the register holding a SIMD point in dimensions 3 and higher. */
+template <int Dim> constexpr int simd_lanes = Dim < AVX2_DIMS_UB ? 4 : 8;
+
+/**
+ * @brief SIMD point in dimensions 3 and higher.
+ *
+ * Coordinates are stored in the lower lanes of a 128-bit register (up to 4 dimensions) or a 256-bit register (up to 8
+ * dimensions, requires AVX-512). Unused lanes are zero.
+ */
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+class point<Dim, true> : boost::multipliable<point<Dim, true>, int> {
+  static constexpr int lanes = simd_lanes<Dim>;
+  using vec = simd_int_t<lanes>;
+
+public:
+  point();
+
+  point(vec coords);
+
+  point(const std::array<int, Dim> &coords);
+
+  static point unit(int i);
+
+  vec data() const { return coords_; }
+
+  int operator[](int i) const;
+
+  bool operator==(const point &p) const;
+
+  bool operator!=(const point &p) const;
+
+  point operator+(const point &p) const;
+
+  point operator-(const point &p) const;
+
+  point &operator*=(int k);
+
+  std::string to_string() const;
+
+private:
+  vec coords_;
+};
+
+/**
+ * @brief SIMD box in dimensions 3 and higher.
+ *
+ * Lower bounds are stored in the lower half of a register twice as wide as that of a point and upper bounds in the
+ * upper half, so that both halves can be acted on by the same point or transform. Unused lanes are zero.
+ */
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+struct box<Dim, true> : boost::additive<box<Dim, true>, point<Dim, true>> {
+  static constexpr int lanes = 2 * simd_lanes<Dim>;
+  using vec = simd_int_t<lanes>;
+
+  vec data_;
+
+  box() = delete;
+
+  box(vec data) : data_(data) {}
+
+  box(const std::array<interval, Dim> &intervals);
+
+  box(std::span<const point<Dim, true>> points);
+
+  vec data() const { return data_; }
+
+  std::array<interval, Dim> intervals() const;
+
+  bool operator==(const box &b) const;
+
+  bool operator!=(const box &b) const;
+
+  interval operator[](int i) const;
+
+  bool empty() const;
+
+  box<Dim, true> &operator+=(const point<Dim, true> &b);
+
+  box<Dim, true> &operator-=(const point<Dim, true> &b);
+
+  box operator|(const box &b) const;
+
+  box operator&(const box &b) const;
+
+  std::array<bool, 2> disjoint(const box &b1, const box &b2) const;
+
+  std::string to_string() const;
+};
+
+/**
+ * @brief SIMD transform in dimensions 3 and higher.
+ *
+ * Writing the transform as S P (see @ref transform_details), lane j of perm_ holds P^-1(j) and lane j of signs_ holds
+ * S(j), so that the j-th component of the image of a point p is S(j) p[P^-1(j)]. Points and boxes are therefore
+ * acted on by a single permutation (gather) followed by a sign instruction. Unused lanes hold the identity.
+ */
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+class transform<Dim, true> {
+  static constexpr int lanes = simd_lanes<Dim>;
+  using vec = simd_int_t<lanes>;
+
+public:
+  transform();
+
+  transform(const std::array<int, Dim> &perm, const std::array<int, Dim> &signs);
+
+  transform(const point<Dim, true> &p, const point<Dim, true> &q);
+
+  template <typename Gen> static transform rand(Gen &gen) {
+    std::array<int, Dim> perm;
+    std::array<int, Dim> signs;
+    rand_signed_perm<Dim>(gen, perm, signs);
+    return transform(perm, signs);
+  }
+
+  static transform rand();
+
+  bool operator==(const transform &t) const;
+
+  point<Dim, true> operator*(const point<Dim, true> &p) const;
+
+  transform operator*(const transform &t) const;
+
+  box<Dim, true> operator*(const box<Dim, true> &b) const;
+
+  bool is_identity() const;
+
+  transform inverse() const;
+
+  std::array<std::array<int, Dim>, Dim> to_matrix() const;
+
+  std::string to_string() const;
+
+private:
+  vec perm_;
+  vec signs_;
+
+  transform(vec perm, vec signs) : perm_(perm), signs_(signs) {}
+};
+
+// Scalar helpers that the SIMD types call. Units compiled with instruction set flags use the copies instantiated in
+// lattice.cpp rather than emit their own, which the linker could hand to the baseline callers.
+template <int Dim> std::string matrix_to_string(const std::array<std::array<int, Dim>, Dim> &matrix);
+
+#define LATTICE_HELPERS_EXTERN(z, n, data)                                                                             \
+  extern template std::string matrix_to_string<n>(const std::array<std::array<int, n>, n> &matrix);                   \
+  extern template void rand_signed_perm<n, philox>(philox &gen, std::array<int, n> &perm, std::array<int, n> &signs);
+
+// cppcheck-suppress syntaxError
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, LATTICE_HELPERS_EXTERN, ~)
+
 } // namespace pivot
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/unordered/unordered_flat_map.hpp>
+
+#include "lattice.h"
+
+namespace pivot {
+
+/**
+ * @brief Occupancy of lattice sites by the sites of a walk, backed by a hash table.
+ *
+ * @details This is the default occupancy container of walk. A container maps each occupied lattice site to the index of
+ * the walk site occupying it, through the following operations:
+ *
+ * - find(p) returns the index of the site at p, or -1 if p is not occupied;
+ * - erase(p) marks the (occupied) lattice site p as free;
+ * - insert(p, i) records that p is occupied by site i, returning false if the container cannot hold p, in which case it
+ *   must be rebuilt with reset before it is used again;
+ * - reset(steps) rebuilds the container from the sites of a walk.
+ */
+template <int Dim, bool Simd = false> class hash_occupancy {
+
+public:
+  explicit hash_occupancy(const std::vector<point<Dim, Simd>> &steps) : map_(steps.size(), point_hash(steps.size())) {
+    reset(steps);
+  }
+
+  int find(const point<Dim, Simd> &p) const {
+    auto it = map_.find(p);
+    return it == map_.end() ? -1 : it->second;
+  }
+
+  void erase(const point<Dim, Simd> &p) { map_.erase(p); }
+
+  bool insert(const point<Dim, Simd> &p, int i) {
+    map_[p] = i;
+    return true;
+  }
+
+  void reset(const std::vector<point<Dim, Simd>> &steps) {
+    map_.clear();
+    for (int i = 0; i < static_cast<int>(steps.size()); ++i) {
+      map_[steps[i]] = i;
+    }
+  }
+
+private:
+  boost::unordered_flat_map<point<Dim, Simd>, int, point_hash> map_;
+};
+
+/**
+ * @brief Occupancy of lattice sites by the sites of a walk, backed by a dense grid.
+ *
+ * @details The grid covers the bounding box of the walk, extended on each side by a margin proportional to its extent
+ * along the corresponding axis, and shrunk around its centre if this exceeds max(2^22, 64 N) cells for a walk of N
+ * sites. Each cell has an occupancy bit and the index of the site occupying it, which is only read when the bit is
+ * set, so lookups of free sites (most lookups when testing a pivot) only touch the bitmap. Sites outside the grid are
+ * kept in a hash table. Inserting fails once an eighth of the sites inside the grid when it was last built have left
+ * it, in which case the grid is recentred on the walk by reset.
+ *
+ * This avoids hashing altogether as long as the walk fits in the grid, i.e. for short walks in low dimensions.
+ *
+ * @see hash_occupancy for the interface.
+ */
+template <int Dim, bool Simd = false>
+  requires(Dim <= 3)
+class grid_occupancy {
+
+public:
+  explicit grid_occupancy(const std::vector<point<Dim, Simd>> &steps) : outside_(0, point_hash(steps.size())) {
+    reset(steps);
+  }
+
+  int find(const point<Dim, Simd> &p) const {
+    auto c = cell(p);
+    if (c >= 0) {
+      return (bits_[c / 64] >> (c % 64) & 1) ? index_[c] : -1;
+    }
+    if (outside_.empty()) {
+      return -1;
+    }
+    auto it = outside_.find(p);
+    return it == outside_.end() ? -1 : it->second;
+  }
+
+  void erase(const point<Dim, Simd> &p) {
+    auto c = cell(p);
+    if (c >= 0) {
+      bits_[c / 64] &= ~(std::uint64_t{1} << (c % 64));
+    } else {
+      outside_.erase(p);
+    }
+  }
+
+  bool insert(const point<Dim, Simd> &p, int i) {
+    auto c = cell(p);
+    if (c < 0) {
+      outside_[p] = i;
+      return outside_.size() <= max_outside_;
+    }
+    bits_[c / 64] |= std::uint64_t{1} << (c % 64);
+    index_[c] = i;
+    return true;
+  }
+
+  void reset(const std::vector<point<Dim, Simd>> &steps);
+
+private:
+  std::array<int, Dim> lo_;                // lattice site of the first cell
+  std::array<unsigned int, Dim> size_;     // number of cells along each axis
+  std::array<std::ptrdiff_t, Dim> stride_; // offset between cells adjacent along each axis
+  std::vector<std::uint64_t> bits_;
+  std::vector<int> index_;
+  boost::unordered_flat_map<point<Dim, Simd>, int, point_hash> outside_;
+  std::size_t max_outside_{}; // number of sites outside the grid beyond which it is recentred
+
+  /** @brief Returns the index of the cell of p, or -1 if p lies outside the grid. */
+  std::ptrdiff_t cell(const point<Dim, Simd> &p) const {
+    std::ptrdiff_t c = 0;
+    for (int i = 0; i < Dim; ++i) {
+      auto x = static_cast<unsigned int>(p[i] - lo_[i]);
+      if (x >= size_[i]) {
+        return -1;
+      }
+      c += x * stride_[i];
+    }
+    return c;
+  }
+};
+
+} // namespace pivot
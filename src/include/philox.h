@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <span>
+
+namespace pivot {
+
+/**
+ * @brief Counter-based random engine Philox4x32-10, from Salmon et al. (2011), producing 64-bit numbers.
+ *
+ * @details The n-th block of 128 bits of stream s is the encryption of the counter (n, s) under a key given by the
+ * seed, so the output at any position of any stream is a pure function of (seed, stream, position) that takes 10 rounds
+ * of two 32-bit multiplications to compute. Streams of the same seed are independent, and need no state beyond their
+ * counter. Each block yields two outputs.
+ *
+ * Satisfies the UniformRandomBitGenerator requirements, so it can be used with the distributions of <random>.
+ */
+class philox {
+
+public:
+  using result_type = std::uint64_t;
+
+  // round multipliers, and increments of the key between rounds
+  static constexpr std::uint64_t m0 = 0xD2511F53;
+  static constexpr std::uint64_t m1 = 0xCD9E8D57;
+  static constexpr std::uint32_t w0 = 0x9E3779B9;
+  static constexpr std::uint32_t w1 = 0xBB67AE85;
+
+  explicit philox(std::uint64_t seed = 0, std::uint64_t stream = 0)
+      : key_{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+        ctr_{0, 0, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)} {}
+
+  /** @brief Generator of the given stream, whose first block was computed beforehand (see first_blocks). */
+  philox(std::uint64_t seed, std::uint64_t stream, const std::array<result_type, 2> &first_block)
+      : philox(seed, stream) {
+    out_ = first_block;
+    next_ = 0;
+    ctr_[0] = 1;
+  }
+
+  static constexpr result_type min() { return 0; }
+
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()();
+
+  /**
+   * @brief Computes the first block of consecutive streams of a seed, starting at the given one, as pairs of outputs.
+   *
+   * @details The streams are processed in groups whose rounds are interleaved, so that their multiplications overlap
+   * rather than wait for each other as they do within a stream.
+   */
+  static void first_blocks(std::uint64_t seed, std::uint64_t first, std::span<std::array<result_type, 2>> blocks);
+
+  /** @brief Returns the block of 4 32-bit numbers for the given counter and key. */
+  static std::array<std::uint32_t, 4> block(std::array<std::uint32_t, 4> ctr, std::array<std::uint32_t, 2> key) {
+    for (int round = 0; round < 10; ++round) {
+      auto p0 = m0 * ctr[0];
+      auto p1 = m1 * ctr[2];
+      ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<std::uint32_t>(p0)};
+      key[0] += w0;
+      key[1] += w1;
+    }
+    return ctr;
+  }
+
+private:
+  std::array<std::uint32_t, 2> key_;
+  std::array<std::uint32_t, 4> ctr_; // index of the next block, then stream
+  std::array<std::uint64_t, 2> out_{};
+  int next_{2}; // index in out_ of the next output, or 2 if the next block is yet to be computed
+};
+
+/**
+ * @brief Same as philox::first_blocks. The specialization for SIMD, in philox_simd.hpp, computes the rounds of 8
+ * streams at once in vector registers.
+ */
+template <bool Simd>
+void philox_first_blocks(std::uint64_t seed, std::uint64_t first,
+                         std::span<std::array<philox::result_type, 2>> blocks) {
+  philox::first_blocks(seed, first, blocks);
+}
+
+// defined in the AVX2 unit only, which the AVX-512 kernels call as well
+template <>
+void philox_first_blocks<true>(std::uint64_t seed, std::uint64_t first,
+                               std::span<std::array<philox::result_type, 2>> blocks);
+
+/**
+ * @brief Random streams of a walk: its k-th pivot proposal (counting from 0) is drawn from philox stream k of its seed.
+ *
+ * Each proposal thus only depends on the seed and on its index, whichever thread draws it, so runs with any number of
+ * workers draw the same proposals as serial ones. The state written by operator<< is the seed and the index of the next
+ * proposal.
+ */
+class proposal_streams {
+
+public:
+  explicit proposal_streams(std::uint64_t seed = 0) : seed_(seed) {}
+
+  /** @brief Returns the generator of the next proposal and moves on to the following one. */
+  philox next() { return philox(seed_, position_++); }
+
+  /** @brief Returns the generator of the proposal with the given index. */
+  philox at(std::uint64_t index) const { return philox(seed_, index); }
+
+  std::uint64_t seed() const { return seed_; }
+
+  /** @brief Returns the index of the next proposal. */
+  std::uint64_t position() const { return position_; }
+
+  void seek(std::uint64_t position) { position_ = position; }
+
+  bool operator==(const proposal_streams &s) const = default;
+
+  friend std::ostream &operator<<(std::ostream &out, const proposal_streams &s) {
+    return out << s.seed_ << ' ' << s.position_;
+  }
+
+  friend std::istream &operator>>(std::istream &in, proposal_streams &s) { return in >> s.seed_ >> s.position_; }
+
+private:
+  std::uint64_t seed_;
+  std::uint64_t position_{};
+};
+
+} // namespace pivot
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <random>
+
+#include "lattice.h"
+#include "philox.h"
+
+namespace pivot {
+
+/** @brief A random pivot proposal: a site of a walk, and a transform to apply about it. */
+template <int Dim, bool Simd> struct proposal_draw {
+  int site;
+  transform<Dim, Simd> trans;
+};
+
+/**
+ * @brief Ring buffer of the upcoming pivot proposals of a walk, drawn from its proposal_streams in batches.
+ *
+ * @details The k-th proposal is the site drawn uniformly in [min_site, max_site] from stream k, followed by the
+ * transform drawn from the same stream, so it does not depend on the batches. Drawing a batch computes the first
+ * Philox block of all its streams in a single vectorised pass (see philox::streams), which is enough for nearly all
+ * proposals, and keeps the generation of proposals out of the loop testing them.
+ */
+template <int Dim, bool Simd> class proposal_queue {
+
+public:
+  /** @brief Number of proposals drawn at once, small enough for the buffer to stay in the L1 cache. */
+  static constexpr std::size_t batch_size = 256;
+
+  proposal_queue() = default;
+
+  proposal_queue(proposal_streams streams, int min_site, int max_site) : streams_(streams), dist_(min_site, max_site) {}
+
+  /** @brief Returns the next proposal and moves on to the following one. */
+  const proposal_draw<Dim, Simd> &next() {
+    if (next_ == num_drawn_) {
+      draw();
+    }
+    return buffer_[next_++];
+  }
+
+  /** @brief Returns the index of the next proposal. */
+  std::uint64_t position() const { return streams_.position() - (num_drawn_ - next_); }
+
+  /** @brief Moves to the proposal with the given index, discarding those already drawn. */
+  void seek(std::uint64_t position) {
+    streams_.seek(position);
+    next_ = num_drawn_ = 0;
+  }
+
+  /** @brief Returns the streams from the next proposal on. */
+  proposal_streams streams() const {
+    auto streams = streams_;
+    streams.seek(position());
+    return streams;
+  }
+
+  /** @brief Writes the state of the streams from the next proposal on, as operator<< of proposal_streams. */
+  friend std::ostream &operator<<(std::ostream &out, const proposal_queue &q) { return out << q.streams(); }
+
+  /** @brief Reads the state of the streams written by operator<<, discarding the proposals already drawn. */
+  friend std::istream &operator>>(std::istream &in, proposal_queue &q) {
+    if (in >> q.streams_) {
+      q.next_ = q.num_drawn_ = 0;
+    }
+    return in;
+  }
+
+private:
+  proposal_streams streams_;
+  std::uniform_int_distribution<int> dist_;
+  std::array<proposal_draw<Dim, Simd>, batch_size> buffer_;
+  std::size_t next_{};      // index in buffer_ of the next proposal
+  std::size_t num_drawn_{}; // number of proposals in buffer_
+
+  void draw() {
+    std::array<std::array<philox::result_type, 2>, batch_size> blocks;
+    auto first = streams_.position();
+    philox_first_blocks<Simd>(streams_.seed(), first, blocks);
+    for (std::size_t i = 0; i < batch_size; ++i) {
+      philox gen(streams_.seed(), first + i, blocks[i]);
+      auto site = dist_(gen);
+      buffer_[i] = {site, transform<Dim, Simd>::rand(gen)};
+    }
+    streams_.seek(first + batch_size);
+    next_ = 0;
+    num_drawn_ = batch_size;
+  }
+};
+
+} // namespace pivot
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lattice.h"
+
+namespace pivot {
+
+/** @brief Destination of the samples recorded during a run, e.g. the endpoints of accepted walks. */
+template <int Dim, bool Simd = false> class sample_sink {
+
+public:
+  virtual ~sample_sink() = default;
+
+  virtual void push(const point<Dim, Simd> &p) = 0;
+};
+
+/**
+ * @brief Writes rows of integers to a file from a background thread.
+ *
+ * Rows are accumulated in a buffer, which is handed over to the writer thread once full. At most two full buffers are
+ * pending at any time, so memory stays bounded: if the disk cannot keep up, push() blocks until a buffer is written.
+ * Each buffer is flushed once written, so the output reaches the disk while the run progresses.
+ */
+class sample_writer {
+
+public:
+  /**
+   * @param path Path to the output file, which is truncated.
+   * @param width Number of integers per row.
+   * @param binary Whether to write rows as consecutive 32-bit integers in the byte order of the machine, rather than as
+   * comma-separated lines.
+   * @param every Only keep every k-th row pushed, starting with the first. Must be positive.
+   * @param buffer_rows Number of rows per buffer.
+   *
+   * @throws std::runtime_error if the file cannot be opened.
+   */
+  sample_writer(const std::string &path, int width, bool binary, int every = 1, std::size_t buffer_rows = 1 << 16);
+
+  sample_writer(const sample_writer &) = delete;
+  sample_writer &operator=(const sample_writer &) = delete;
+
+  /** @brief Calls close(), ignoring errors. */
+  ~sample_writer();
+
+  /**
+   * @brief Records a row of width integers, unless it is skipped by decimation.
+   *
+   * @throws std::runtime_error if a previous buffer could not be written.
+   */
+  void push(const int *row);
+
+  /**
+   * @brief Writes the remaining rows and stops the writer thread. Does nothing if already closed.
+   *
+   * @throws std::runtime_error if the file could not be written.
+   */
+  void close();
+
+private:
+  static constexpr std::size_t max_pending = 2;
+
+  int width_;
+  bool binary_;
+  int every_;
+  std::size_t buffer_rows_;
+  long long count_{};
+  std::vector<int> buffer_; // rows pushed since the last hand-over
+
+  std::ofstream file_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable written_;
+  std::deque<std::vector<int>> pending_;
+  std::exception_ptr error_;
+  bool stop_{};
+  bool closed_{};
+
+  void hand_over();
+
+  void write(const std::vector<int> &rows);
+
+  void work();
+};
+
+/** @brief Streams samples to a CSV or binary file through a sample_writer. */
+template <int Dim, bool Simd = false> class file_sink : public sample_sink<Dim, Simd> {
+
+public:
+  /** @see sample_writer::sample_writer */
+  file_sink(const std::string &path, bool binary, int every = 1) : writer_(path, Dim, binary, every) {}
+
+  void push(const point<Dim, Simd> &p) override {
+    std::array<int, Dim> row;
+    for (int i = 0; i < Dim; ++i) {
+      row[i] = p[i];
+    }
+    writer_.push(row.data());
+  }
+
+  /** @see sample_writer::close */
+  void close() { writer_.close(); }
+
+private:
+  sample_writer writer_;
+};
+
+} // namespace pivot
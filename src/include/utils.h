@@ -1,13 +1,56 @@
+#pragma once
+
+#include <string>
 #include <vector>
 
 #include "lattice.h"
 
 namespace pivot {
 
+/** @brief Contents of a checkpoint: the sites of a walk and, for binary checkpoints, the state of its random engine. */
+template <int Dim, bool Simd> struct checkpoint {
+  std::vector<point<Dim, Simd>> steps;
+  std::string rng_state; // as written by operator<< of proposal_streams, or empty if not saved
+};
+
 template <int Dim, bool Simd> std::vector<point<Dim, Simd>> from_csv(const std::string &path);
 
 template <int Dim, bool Simd> void to_csv(const std::string &path, const std::vector<point<Dim, Simd>> &points);
 
+/** @brief Returns whether the file at the given path starts with the header of a binary checkpoint. */
+bool is_bin(const std::string &path);
+
+/**
+ * @brief Reads a binary checkpoint written by to_bin.
+ *
+ * @details The file is memory-mapped and decoded in a single pass. Checkpoints written in other versions of the format
+ * are rejected.
+ *
+ * @throws std::runtime_error if the file cannot be read, or is not a valid checkpoint of a walk in Dim dimensions in
+ * the current version of the format.
+ */
+template <int Dim, bool Simd> checkpoint<Dim, Simd> from_bin(const std::string &path);
+
+/**
+ * @brief Writes a binary checkpoint of a walk.
+ *
+ * @details The file starts with a fixed header (magic string, format version, dimension, number of sites and length of
+ * the random engine state), followed by the random engine state, the coordinates of the first site and one byte per
+ * subsequent step encoding its direction. Integers are stored in the byte order of the machine.
+ *
+ * @param path Path to the file to write.
+ * @param steps Sites of the walk. Consecutive sites must be neighbours on the lattice.
+ * @param rng_state State of the random engine of the walk, as written by operator<<.
+ *
+ * @throws std::invalid_argument if two consecutive sites are not neighbours.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+template <int Dim, bool Simd>
+void to_bin(const std::string &path, const std::vector<point<Dim, Simd>> &steps, const std::string &rng_state = "");
+
+/** @brief Reads a checkpoint in either format, as detected from the contents of the file. */
+template <int Dim, bool Simd> checkpoint<Dim, Simd> from_file(const std::string &path);
+
 template <int Dim, bool Simd> std::vector<point<Dim, Simd>> line(int num_steps);
 
 } // namespace pivot
@@ -1,22 +1,32 @@
 #pragma once
 
-#include <future>
+#include <memory>
 #include <optional>
 #include <random>
 
-#include <boost/unordered/unordered_flat_map.hpp>
-
 #include "lattice.h"
+#include "occupancy.h"
+#include "proposals.h"
+#include "utils.h"
 #include "walk_base.h"
+#include "worker_pool.h"
 
 namespace pivot {
 
-template <int Dim, bool Simd = false> class walk : public walk_base<Dim, Simd> {
+/**
+ * @brief Self-avoiding walk stored as an array of sites, along with the set of lattice sites they occupy.
+ *
+ * @tparam Occupancy Container of occupied lattice sites: hash_occupancy, or grid_occupancy for short walks in up to 3
+ * dimensions.
+ */
+template <int Dim, bool Simd = false, class Occupancy = hash_occupancy<Dim, Simd>>
+class walk final : public walk_base<Dim, Simd> {
 
 public:
   walk(const std::vector<point<Dim, Simd>> &steps, std::optional<unsigned int> seed = std::nullopt);
   walk(int num_steps, std::optional<unsigned int> seed = std::nullopt);
   walk(const std::string &path, std::optional<unsigned int> seed = std::nullopt);
+  walk(const checkpoint<Dim, Simd> &data, std::optional<unsigned int> seed = std::nullopt);
 
   walk(const walk &w) = delete;
   walk(walk &&w) = delete;
@@ -24,34 +34,151 @@ public:
 
   ~walk() = default;
 
-  point<Dim, Simd> operator[](int i) const { return steps_[i]; }
+  point<Dim, Simd> operator[](int i) const { return frame_ * steps_[i] + offset_; }
 
   int num_steps() const { return steps_.size(); }
 
-  point<Dim, Simd> endpoint() const override { return steps_.back(); }
+  point<Dim, Simd> endpoint() const override { return (*this)[num_steps() - 1]; }
+
+  std::vector<point<Dim, Simd>> steps() const;
 
+  /** @brief Tests a pivot of the sites after the given one, returning their new positions on success. */
   std::optional<std::vector<point<Dim, Simd>>> try_pivot(int step, const transform<Dim, Simd> &trans) const;
 
   std::pair<int, std::optional<std::vector<point<Dim, Simd>>>> try_rand_pivot() const;
 
+  /**
+   * @brief Checks whether a pivot keeps the walk self-avoiding, using Kennedy's algorithm.
+   *
+   * Rather than pivoting every site after the given one, only the shorter side of the walk is moved, by the inverse
+   * transform if it is the side before the pivot site. Its sites are visited outward from the pivot site and looked up
+   * in the hash table of occupied sites. The test thus stops at the first collision, which is typically close to the
+   * pivot site, and a successful pivot costs half as many lookups as with try_pivot on average.
+   *
+   * @return Whether the pivot succeeds.
+   */
+  bool test_pivot_fast(int step, const transform<Dim, Simd> &trans) const;
+
+  /**
+   * @brief Attempts a random pivot.
+   *
+   * @param fast Whether to test the pivot with test_pivot_fast. This yields the same walk for a given seed, with or
+   * without worker threads.
+   */
   bool rand_pivot(bool fast = false) override;
 
+  /**
+   * @brief Attempts a batch of random pivots, calling observer(*this) after each successful one.
+   *
+   * Unlike repeated calls to rand_pivot through walk_base, the attempts are not dispatched virtually, and the observer
+   * can be inlined into the loop.
+   *
+   * @param iters Number of pivot attempts.
+   * @param fast See rand_pivot.
+   *
+   * @return Number of successful pivots.
+   */
+  template <class Observer> int run(int iters, Observer &&observer, bool fast = false) {
+    int num_success = 0;
+    for (int i = 0; i < iters; ++i) {
+      if (rand_pivot(fast)) {
+        observer(*this);
+        ++num_success;
+      }
+    }
+    return num_success;
+  }
+
+  /**
+   * @brief Attempts a random pivot while worker threads test upcoming proposals.
+   *
+   * Equivalent to calling set_num_workers(num_workers) (if the number of workers has changed) followed by rand_pivot().
+   */
   bool rand_pivot(int num_workers);
 
+  /**
+   * @brief Set the number of threads used to test random pivot proposals.
+   *
+   * When enabled, upcoming proposals are drawn as in the serial case (see proposal_queue) and workers test them
+   * concurrently into their own scratch buffers. Proposals are then consumed in order. After a pivot is
+   * committed, a rejected proposal is kept (rather than re-tested) if the pair of sites found to collide lies before
+   * the committed pivot site, since such a pair is not moved by it. The proposals, and thus the walk, are the same as
+   * without workers, whatever their number.
+   *
+   * @param num_workers Number of worker threads, including the calling thread. Zero disables worker threads.
+   *
+   * @note Pending proposals are discarded when the number of workers is changed, and drawn again afterwards.
+   */
+  void set_num_workers(int num_workers);
+
   bool self_avoiding() const override;
 
   void export_csv(const std::string &path) const override;
 
-protected:
-  std::vector<point<Dim, Simd>> steps_;
-  boost::unordered_flat_map<point<Dim, Simd>, int, point_hash> occupied_;
+  void export_bin(const std::string &path) const override;
 
-  mutable std::mt19937 rng_;
-  mutable std::uniform_int_distribution<int> dist_;
-
-  void do_pivot(int step, std::vector<point<Dim, Simd>> &new_points);
-
-  point<Dim, Simd> pivot_point(int step, int i, const transform<Dim, Simd> &trans) const;
+private:
+  // Sites are stored in a local frame: site i is at frame_ * steps_[i] + offset_. A pivot then only moves the shorter
+  // side of the walk, since moving the sites before the pivot site by the inverse transform and applying the transform
+  // to the frame yields the same walk.
+  std::vector<point<Dim, Simd>> steps_;
+  transform<Dim, Simd> frame_;
+  point<Dim, Simd> offset_{};
+  Occupancy occupied_; // lattice sites are in the local frame
+  std::vector<point<Dim, Simd>> new_points_; // buffer for the pivoted sites of serial proposals
+
+  mutable proposal_queue<Dim, Simd> queue_;
+
+  /** @brief A random pivot proposal together with the outcome of its test. */
+  struct proposal {
+    int step;
+    transform<Dim, Simd> trans;
+    bool tested;
+    bool accepted;
+    std::pair<int, int> collision; // sites found to collide if rejected
+  };
+
+  std::unique_ptr<worker_pool> pool_;
+  std::vector<std::vector<point<Dim, Simd>>> scratch_; // per-worker buffers for pivoted sites
+  std::vector<proposal> proposals_;                    // pending proposals, in the order in which they are consumed
+  size_t next_proposal_{};                             // index in proposals_ of the next proposal to be consumed
+
+  /**
+   * @brief Tests a pivot and, on success, writes the pivoted sites of the shorter side into new_points.
+   *
+   * The k-th point of new_points is the new local position of the site at distance k from the pivot site, after it
+   * if there are no more sites after the pivot site than before it, and before it otherwise (see do_pivot).
+   *
+   * @param new_points Buffer of at least num_steps() / 2 points.
+   * @param fast Whether to test the pivot with test_pivot_fast rather than test_pivot.
+   *
+   * @return Whether the pivot succeeds. On failure, collision holds a pair of sites found to collide.
+   */
+  bool try_pivot(int step, const transform<Dim, Simd> &trans, std::vector<point<Dim, Simd>> &new_points,
+                 std::pair<int, int> &collision, bool fast = false) const;
+
+  /** @brief Tests a pivot by the local transform u, visiting every site after the pivot site. */
+  bool test_pivot(int step, const transform<Dim, Simd> &u, std::pair<int, int> &collision) const;
+
+  /**
+   * @brief Same as the public overload, but for the local transform u. On failure, collision holds a pair of sites
+   * found to collide.
+   */
+  bool test_pivot_fast(int step, const transform<Dim, Simd> &u, std::pair<int, int> &collision) const;
+
+  bool rand_pivot_parallel(bool fast);
+
+  /** @brief Tops up the pending proposals and tests them concurrently, each worker stopping at its first success. */
+  void test_proposals(bool fast);
+
+  /**
+   * @brief Commits a pivot tested by try_pivot, updating only the sites of the shorter side in occupied_, which is
+   * rebuilt if it cannot hold their new positions.
+   */
+  void do_pivot(int step, const transform<Dim, Simd> &trans, const std::vector<point<Dim, Simd>> &new_points);
+
+  /** @brief Returns the transform of the local frame corresponding to the given transform of the walk. */
+  transform<Dim, Simd> local(const transform<Dim, Simd> &trans) const;
 };
 
 } // namespace pivot
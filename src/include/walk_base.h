@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "lattice.h"
 
 namespace pivot {
@@ -15,6 +17,9 @@ public:
 
   virtual void export_csv(const std::string &path) const = 0;
 
+  /** @brief Export the walk, along with the state of its random engine, to a binary checkpoint (see to_bin). */
+  virtual void export_bin(const std::string &path) const = 0;
+
   virtual point<Dim, Simd> endpoint() const = 0;
 };
 
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <span>
+#include <type_traits>
 
 #include "defines.h"
 #include "graphviz.h"
@@ -30,23 +35,43 @@ public:
   /** @brief Returns the root of a walk tree for the pivot representation of sequence of lattice sites.
    *
    * @param steps The lattice sites of the walk. Must have size at least 2 (single step).
-   * @param buf An optional buffer in which to store the tree nodes.
+   * @param buf Arena in which to store the tree nodes. Must have room for steps.size() nodes: the leaf sentinel is
+   * stored at index 0 and the node with id n at index n.
    *
    * @return The root of the walk tree.
    */
-  static walk_node *pivot_rep(const std::vector<point<Dim, Simd>> &steps, walk_node *buf = nullptr);
+  static walk_node *pivot_rep(const std::vector<point<Dim, Simd>> &steps, walk_node *buf);
 
   /** @brief Returns the root of a walk tree for the balanced representation of a walk given by a sequence of points.
    *
-   * @param steps The lattice sites of the walk. Must have size at least 2 (single step).
-   * @param buf An optional buffer in which to store the tree nodes.
+   * @param steps The lattice sites of the walk. Must have size at least 2 (single step) and, if leaf_size is greater
+   * than 1, more than leaf_size.
+   * @param buf Arena in which to store the tree nodes. Must have room for num_slots(steps.size(), leaf_size) nodes: the
+   * leaf sentinel is stored at index 0, the node with id n at index n / leaf_size and, if leaf_size is greater than 1,
+   * the leaf holding the j-th block of sites at index b + j * leaf_slots(leaf_size), where b is the number of blocks.
+   * @param leaf_size Number of consecutive sites held by each leaf (the last leaf may hold fewer). Must be between 1
+   * and max_leaf_size. Leaves holding a single site all share the sentinel.
    *
    * @return The root of the walk tree.
    */
-  static walk_node *balanced_rep(const std::vector<point<Dim, Simd>> &steps, walk_node *buf = nullptr);
+  static walk_node *balanced_rep(const std::vector<point<Dim, Simd>> &steps, walk_node *buf, int leaf_size = 1);
 
-  /** @brief Copies the given node but none of the nodes it links to. */
-  walk_node(const walk_node &w) = default;
+  /**
+   * @brief Maximum number of sites held by a leaf.
+   *
+   * Leaves store the coordinates of their sites relative to their own frame, in which every site lies within
+   * max_leaf_size of the origin, packed into one byte per coordinate.
+   */
+  static constexpr int max_leaf_size = 64;
+
+  /** @brief Maximum height of a tree for which shuffle_intersect can be used. */
+  static constexpr int max_height = 62;
+
+  /** @brief Number of arena slots taken up by a leaf holding the given number of sites, including its coordinates. */
+  static int leaf_slots(int num_sites);
+
+  /** @brief Number of arena slots needed by balanced_rep. */
+  static std::size_t num_slots(int num_sites, int leaf_size);
 
   walk_node(walk_node &&w) = delete;
   walk_node &operator=(const walk_node &w) = delete;
@@ -64,9 +89,20 @@ public:
 
   const transform<Dim, Simd> &symm() const { return symm_; }
 
-  walk_node *left() const { return left_; }
+  /** @brief Returns the number of edges on the longest path from the node down to a leaf, saturating at 255. */
+  int height() const { return height_; }
+
+#ifdef ENABLE_OBSERVABLES
+  /** @brief Returns the sum of the positions of the sites of the subtree, in its frame. */
+  const std::array<double, Dim> &site_sum() const { return site_sum_; }
 
-  walk_node *right() const { return right_; }
+  /** @brief Returns the sum of the squared norms of the positions of the sites of the subtree, in its frame. */
+  double site_sum_sq() const { return site_sum_sq_; }
+#endif
+
+  walk_node *left() const { return at(left_); }
+
+  walk_node *right() const { return at(right_); }
 
   /** @brief Checks if two nodes hold the same data, but not whether they are part of the same tree. */
   bool operator==(const walk_node &other) const;
@@ -81,22 +117,16 @@ public:
   /**
    * @brief Perform a left rotation.
    *
-   * @param set_parent Whether to modify links between nodes bidirectionally. Should typically only be set to false
-   * when called from shuffle_intersect.
-   *
    * @return The new root of the subtree.
    */
-  walk_node *rotate_left(bool set_parent = true);
+  walk_node *rotate_left();
 
   /**
    * @brief Perform a right rotation.
    *
-   * @param set_parent Whether to modify links between nodes bidirectionally. Should typically only be set to false
-   * when called from shuffle_intersect.
-   *
    * @return The new root of the subtree.
    */
-  walk_node *rotate_right(bool set_parent = true);
+  walk_node *rotate_right();
 
   /* USER-LEVEL OPERATIONS (see Clisby (2010), Section 2.6) */
 
@@ -112,21 +142,22 @@ public:
   /**
    * @brief Shuffle the current node down to the appropriate level in a balanced tree.
    *
-   * @param id The id of the node to shuffle down.
+   * @param leaf_size Number of sites held by each leaf of the tree (see balanced_rep).
    *
    * @return The new root of the tree.
    */
-  walk_node *shuffle_down();
+  walk_node *shuffle_down(int leaf_size = 1);
 
   /**
    * @brief Checks if the given transform applied at the current node creates an intersection via a bottom-up algorithm.
    *
+   * The tree is only read, so concurrent calls are safe.
+   *
    * @param t The given transform.
-   * @param is_left_child Whether the current node is the left child of its parent.
    *
    * @return Whether the transform creates an intersection.
    */
-  bool shuffle_intersect(const transform<Dim, Simd> &t, std::optional<bool> is_left_child);
+  bool shuffle_intersect(const transform<Dim, Simd> &t) const;
 
   /**
    * @brief Checks if the current walk has an intersection via a top-down algorithm.
@@ -142,45 +173,134 @@ public:
   void todot(const std::string &path) const;
 
 private:
+  // Links are offsets (in nodes) relative to the current node within the arena holding the tree, with 0 denoting no
+  // link. Leaves link to the sentinel at index 0 of the arena, which has no links itself.
   int id_;
   int num_sites_;
-  walk_node *parent_{};
-  walk_node *left_{};
-  walk_node *right_{};
+  std::int32_t parent_{};
+  std::int32_t left_{};
+  std::int32_t right_{};
+  std::uint8_t height_{}; // fits in padding before the symmetry
   transform<Dim, Simd> symm_;
   box<Dim, Simd> bbox_;
   point<Dim, Simd> end_;
+#ifdef ENABLE_OBSERVABLES
+  // Moments of the sites of the subtree, from which walk_tree computes observables in constant time. Doubles hold
+  // the sums of coordinates exactly for walks of up to about 10^8 sites.
+  std::array<double, Dim> site_sum_{};
+  double site_sum_sq_{};
+#endif
 
   friend class walk_tree<Dim, Simd>;
 
+  /** @brief Coordinates of a site in a leaf, packed into one byte each and padded to a size that compares quickly. */
+  using site_key = std::conditional_t<
+      (Dim <= 2), std::uint16_t,
+      std::conditional_t<(Dim <= 4), std::uint32_t,
+                         std::conditional_t<(Dim <= 8), std::uint64_t, std::array<std::int8_t, Dim>>>>;
+
   /* CONVENIENCE METHODS */
 
   walk_node(int id, int num_sites, const transform<Dim, Simd> &symm, const box<Dim, Simd> &bbox,
             const point<Dim, Simd> &end);
 
+  // heights saturate, since they are only of interest for trees that are close to balanced
+  static constexpr int max_stored_height = 255;
+
+  void update_height() {
+    height_ = std::min(1 + std::max(left()->height_, right()->height_), max_stored_height);
+  }
+
+  /**
+   * @brief Recomputes the moments of the sites of the subtree from its children, or from its sites for a leaf. Does
+   * nothing unless ENABLE_OBSERVABLES is defined.
+   */
+  void update_moments();
+
+  /** @brief Copies the links verbatim, so the copy is only valid at the same index of another arena. */
+  walk_node(const walk_node &w) = default;
+
+  walk_node *at(std::int32_t offset) const { return offset ? const_cast<walk_node *>(this) + offset : nullptr; }
+
+  std::int32_t offset_of(const walk_node *node) const { return node ? static_cast<std::int32_t>(node - this) : 0; }
+
+  walk_node *parent() const { return at(parent_); }
+
+  void set_parent(walk_node *parent) { parent_ = offset_of(parent); }
+
   void set_left(walk_node *left) {
-    left_ = left;
+    left_ = offset_of(left);
     if (left != nullptr && !left->is_leaf()) {
-      left->parent_ = this;
+      left->set_parent(this);
     }
   }
 
   void set_right(walk_node *right) {
-    right_ = right;
+    right_ = offset_of(right);
     if (right != nullptr && !right->is_leaf()) {
-      right->parent_ = this;
+      right->set_parent(this);
     }
   }
 
   std::optional<bool> is_left_child() const {
-    if (parent_ == nullptr) {
+    if (parent_ == 0) {
       return std::nullopt;
     }
-    return parent_->left_ == this;
+    return parent()->left() == this;
   }
 
   static walk_node create_leaf();
-  static walk_node &leaf();
+
+  /* LEAVES */
+
+  // The coordinates of the sites held by a leaf are stored in the arena slots following it. Leaves holding a single
+  // site (such as the sentinel) store none, as that site is always e0.
+
+  /** @brief Creates a leaf holding the given sites, which must start at e0, in the given slots. */
+  static walk_node *create_leaf(int id, std::span<const point<Dim, Simd>> sites, walk_node *dest);
+
+  std::int8_t *coords() const { return reinterpret_cast<std::int8_t *>(const_cast<walk_node *>(this) + 1); }
+
+  /** @brief Stores the coordinates of the sites held by a leaf. */
+  void store_sites(std::span<const point<Dim, Simd>> sites);
+
+  /** @brief Returns the i-th site held by a leaf, relative to the leaf. */
+  point<Dim, Simd> site(int i) const;
+
+  /** @brief Returns the i-th site held by a leaf in packed form. */
+  site_key key(int i) const;
+
+  /**
+   * @brief Packs a point, clamping coordinates to the range of a byte. Since no site of a leaf is that far from the
+   * origin, points outside that range never compare equal to any site of a leaf.
+   */
+  static site_key pack(const point<Dim, Simd> &p);
+
+  /** @brief Checks whether two leaves, placed by their anchors and symmetries, have a site in common. */
+  static bool leaf_intersect(const walk_node *l_leaf, const walk_node *r_leaf, const point<Dim, Simd> &l_anchor,
+                             const point<Dim, Simd> &r_anchor, const transform<Dim, Simd> &l_symm,
+                             const transform<Dim, Simd> &r_symm);
+
+  /**
+   * @brief Splits a leaf before its i-th site into a node whose children are leaves holding the sites on either side.
+   *
+   * The node plays the role of the missing node with id id() + i, so that a pivot about a site inside a leaf can be
+   * tested in the same way as any other. Links from the node's children to the rest of the tree are not set.
+   *
+   * @param dest Uninitialized slots in the same arena as the leaf, at least 2 * leaf_slots(n) + 1 of them, where n is
+   * the number of sites held by the leaf.
+   *
+   * @return The node, stored at dest.
+   */
+  walk_node *split_into(int i, walk_node *dest) const;
+
+  /**
+   * @brief Pivots the sites of the last leaf of the subtree, from its i-th site onward, with the given transform
+   * applied in the frame of the node that split_into(i) would create, updating the nodes on the way.
+   *
+   * @return The transform undergone by any sites following the subtree, in the frame of the subtree.
+   */
+  transform<Dim, Simd> pivot_leaf(int i, const transform<Dim, Simd> &t);
 
   /* RECURSION HELPERS */
 
@@ -188,10 +308,11 @@ private:
 
   // recursive helper
   static walk_node *balanced_rep(std::span<const point<Dim, Simd>> steps, int start,
-                                 const transform<Dim, Simd> &glob_symm, walk_node *buf);
+                                 const transform<Dim, Simd> &glob_symm, walk_node *buf, int leaf_size,
+                                 walk_node *leaves);
 
-  bool shuffle_intersect(const transform<Dim, Simd> &t, std::optional<bool> was_left_child,
-                         std::optional<bool> is_left_child);
+  // takes the side of the parent on which the node lies, as nodes splitting a leaf are not linked from their parent
+  bool shuffle_intersect(const transform<Dim, Simd> &t, std::optional<bool> is_left_child) const;
 
   template <int D, bool S>
   friend bool intersect(const walk_node<D, S> *l_walk, const walk_node<D, S> *r_walk, const point<D, S> &l_anchor,
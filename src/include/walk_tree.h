@@ -1,19 +1,33 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <optional>
 #include <random>
+#include <span>
+#include <utility>
 #include <vector>
 
 #include "lattice.h"
+#include "proposals.h"
+#include "utils.h"
 #include "walk_base.h"
+#include "worker_pool.h"
 
 namespace pivot {
 
 template <int Dim, bool Simd> class walk_node;
 
-/** @brief Represents an entire saw-tree (as per Clisby's 2010 paper). */
-template <int Dim, bool Simd = false> class walk_tree : public walk_base<Dim, Simd> {
+/**
+ * @brief Represents an entire saw-tree (as per Clisby's 2010 paper).
+ *
+ * @details Each leaf of the tree may hold a block of up to walk_node::max_leaf_size consecutive sites rather than a
+ * single one. Nodes then only split the walk between blocks, which divides their number, and the height of the tree,
+ * by the block size, at the cost of comparing pairs of leaves site by site when checking for intersections. Pivots
+ * about sites inside a block are tested by splitting the leaf holding it into a temporary node and committed by
+ * updating the coordinates held by the leaf.
+ */
+template <int Dim, bool Simd = false> class walk_tree final : public walk_base<Dim, Simd> {
 
 public:
   /* CONSTRUCTORS, DESTRUCTOR */
@@ -26,24 +40,30 @@ public:
    * number generator used for pivoting. If not provided, a random seed is chosen.
    * @param balanced Whether to construct the tree using a balanced representation (the deafult) or the
    * (imbalanced) "pivot representation".
+   * @param leaf_size Number of consecutive sites held by each leaf of the tree (see the class description). Values
+   * greater than 1 require balanced=true and more than leaf_size sites.
    *
    * @warning It is not recommended to set balanced=false.
    */
-  walk_tree(int num_sites, std::optional<unsigned int> seed = std::nullopt, bool balanced = true);
+  walk_tree(int num_sites, std::optional<unsigned int> seed = std::nullopt, bool balanced = true, int leaf_size = 1);
 
   /**
    * @brief Load a walk tree from a given checkpoint.
    *
-   * @param path Path to the checkpoint file. Should be in a CSV file in which each line is a lattice site,
-   * represented as a comma-separated list of integers.
+   * @param path Path to the checkpoint file: either a binary checkpoint written by export_bin, or a CSV file in which
+   * each line is a lattice site, represented as a comma-separated list of integers. The format is detected from the
+   * contents of the file.
    * @param seed Random seed. Not used in construction of the initial tree, but rather to seed the random
-   * number generator used for pivoting. If not provided, a random seed is chosen.
+   * number generator used for pivoting. If not provided, the state saved in a binary checkpoint is restored, and
+   * otherwise a random seed is chosen.
    * @param balanced Whether to construct the tree using a balanced representation (the deafult) or the
    * (imbalanced) "pivot representation".
+   * @param leaf_size Number of consecutive sites held by each leaf of the tree.
    *
    * @warning It is not recommended to set balanced=false.
    */
-  walk_tree(const std::string &path, std::optional<unsigned int> seed = std::nullopt, bool balanced = true);
+  walk_tree(const std::string &path, std::optional<unsigned int> seed = std::nullopt, bool balanced = true,
+            int leaf_size = 1);
 
   /**
    * @brief Construct a walk tree from a given sequence of lattice sites.
@@ -53,11 +73,25 @@ public:
    * number generator used for pivoting. If not provided, a random seed is chosen.
    * @param balanced Whether to construct the tree using a balanced representation (the deafult) or the
    * (imbalanced) "pivot representation".
+   * @param leaf_size Number of consecutive sites held by each leaf of the tree.
    *
    * @warning It is not recommended to set balanced=false.
    */
   walk_tree(const std::vector<point<Dim, Simd>> &steps, std::optional<unsigned int> seed = std::nullopt,
-            bool balanced = true);
+            bool balanced = true, int leaf_size = 1);
+
+  /**
+   * @brief Construct a walk tree from the contents of a checkpoint.
+   *
+   * @param data Sites of the walk and, optionally, the state of the random engine used for pivoting.
+   * @param seed Random seed. If provided, or if the checkpoint holds no random engine state, the random engine is
+   * seeded as by the other constructors. Otherwise, its state is restored from the checkpoint.
+   * @param balanced Whether to construct the tree using a balanced representation (the deafult) or the
+   * (imbalanced) "pivot representation".
+   * @param leaf_size Number of consecutive sites held by each leaf of the tree.
+   */
+  walk_tree(const checkpoint<Dim, Simd> &data, std::optional<unsigned int> seed = std::nullopt, bool balanced = true,
+            int leaf_size = 1);
 
   /**@brief Deallocates the entire tree and every node it contains. */
   ~walk_tree();
@@ -75,7 +109,7 @@ public:
   /**
    * @brief Find a node by its id
    *
-   * @param n node id
+   * @param n node id. Since nodes only split the walk between leaves, must be a multiple of the leaf size.
    *
    * @note Runs in constant time.
    *
@@ -97,6 +131,8 @@ public:
    * @note Since lattice sites are numbered starting at 0, the restriction n > 0 is equivalent to prohibiting
    * gloval transformations of the walk.
    *
+   * @note Pivots about sites inside a leaf have no node to shuffle up and are attempted as in try_pivot_fast.
+   *
    * @return Whether the pivot was successful.
    */
   bool try_pivot(int n, const transform<Dim, Simd> &r);
@@ -117,12 +153,68 @@ public:
   /**
    * @brief Attempts to pivot the walk about a randomly chosen lattice site with a random transform.
    *
-   * @param fast Whether to use the fast version of the pivot function.
+   * @param fast Whether to use the fast version of the pivot function. Ignored if worker threads have been enabled
+   * via set_num_workers, in which case the fast version is always used.
    *
    * @return Whether the pivot was successful.
    */
   bool rand_pivot(bool fast = true) override;
 
+  /**
+   * @brief Attempts a batch of random pivots, calling observer(*this) after each successful one.
+   *
+   * Unlike repeated calls to rand_pivot through walk_base, the attempts are not dispatched virtually, and the observer
+   * can be inlined into the loop.
+   *
+   * @param iters Number of pivot attempts.
+   * @param fast See rand_pivot.
+   *
+   * @return Number of successful pivots.
+   */
+  template <class Observer> int run(int iters, Observer &&observer, bool fast = true) {
+    int num_success = 0;
+    for (int i = 0; i < iters; ++i) {
+      if (rand_pivot(fast)) {
+        observer(*this);
+        ++num_success;
+      }
+    }
+    return num_success;
+  }
+
+  /**
+   * @brief Set the number of threads used to test random pivot proposals.
+   *
+   * When enabled, rand_pivot draws proposals in batches from the same queue as in the serial case (see
+   * proposal_queue) and tests them concurrently against the current (read-only) tree using Clisby's
+   * Attempt_pivot_fast intersection test. Accepted proposals are then committed in order and any proposals drawn after
+   * an accepted one are re-tested against the updated walk, so that the resulting Markov chain coincides with the
+   * serial one (cf. Clisby and Ho (2021)).
+   *
+   * @param num_workers Number of worker threads, including the calling thread. Zero disables worker threads.
+   *
+   * @note Pending proposals are discarded when the number of workers is changed, and drawn again afterwards.
+   */
+  void set_num_workers(int num_workers);
+
+  /**
+   * @brief Let the tree become unbalanced after accepted pivots, by up to the given number of levels.
+   *
+   * By default, the tree is restored to its balanced shape after every accepted pivot (shuffle_down in Clisby (2010)),
+   * which costs as many rotations as shuffling up the pivot site. With a positive slack, the pivot site is left at the
+   * root instead, until the tree becomes more than slack levels taller than a balanced tree. Only the subtrees that
+   * are taller than a balanced tree with as many sites are then rebalanced, i.e. those along the paths of recent
+   * pivots. Nodes are found through an index updated by the rotations, so find_node still runs in constant time.
+   *
+   * @param slack Number of extra levels allowed.
+   *
+   * @note The walk is not affected, so the resulting Markov chain is the same for any slack.
+   *
+   * @note Rotations move nodes around the arena, so once a tree has been allowed to become unbalanced, a slack of zero
+   * keeps it no taller than a balanced tree rather than restoring the exact shape after every pivot.
+   */
+  void set_rebalance_slack(int slack);
+
   /* OTHER FUNCTIONS */
 
   /**
@@ -132,6 +224,59 @@ public:
    */
   std::vector<point<Dim, Simd>> steps() const;
 
+  /**
+   * @brief Returns the i-th site of the walk.
+   *
+   * @details Descends from the root to the leaf holding the site, composing the frames of the nodes on the way, as
+   * steps does for every site at once.
+   *
+   * @note Runs in O(log N) time for balanced trees (in the height of the tree in general), and allocates nothing.
+   */
+  point<Dim, Simd> site(int i) const;
+
+  /**
+   * @brief Returns the sites of the walk with the given indices, which must be in increasing order.
+   *
+   * @note Each node is visited once for all the sites below it, so nearby indices share most of their path.
+   */
+  std::vector<point<Dim, Simd>> sites(std::span<const int> indices) const;
+
+  /**
+   * @brief Returns the bounding box of the sites of the walk with indices in [i, j).
+   *
+   * @details Subtrees lying within the range contribute the bounding box stored at their root, so only the nodes on
+   * the paths to sites i and j are visited, and the sites of the two leaves at the ends of the range.
+   *
+   * @note Runs in O(log N) time for balanced trees, and allocates nothing.
+   */
+  box<Dim, Simd> bbox(int i, int j) const;
+
+  /**
+   * @brief Returns the bounding boxes of consecutive pieces of the walk, the k-th of which holds the sites with indices
+   * in [bounds[k], bounds[k + 1]).
+   *
+   * @param bounds Bounds of the pieces, in strictly increasing order. There must be at least 2 of them.
+   *
+   * @note Each node is visited once for all the pieces overlapping it.
+   */
+  std::vector<box<Dim, Simd>> bboxes(std::span<const int> bounds) const;
+
+  /**
+   * @brief Returns the squared radius of gyration of the walk, i.e. the mean squared distance from its sites to their
+   * centre of mass.
+   *
+   * @note Runs in constant time if the library is built with ENABLE_OBSERVABLES, in which case each node keeps the
+   * moments of the sites of its subtree, at the cost of O(log N) updates per accepted pivot. Otherwise runs in O(N).
+   */
+  double squared_radius_of_gyration() const;
+
+  /**
+   * @brief Returns the mean squared distance from the sites of the walk to its endpoint.
+   *
+   * @note Runs in constant time if the library is built with ENABLE_OBSERVABLES (see squared_radius_of_gyration).
+   */
+  double mean_squared_distance_to_endpoint() const;
+
   /**
    * @brief Check whether the walk is self-avoiding using a naive algorithm.
    *
@@ -145,14 +290,119 @@ public:
   /** @brief Export the walk to a CSV file. */
   void export_csv(const std::string &path) const override;
 
+  /**
+   * @brief Export the walk to a binary checkpoint, along with the state of the random engine.
+   *
+   * @note Node frames are not saved, so a tree loaded from the checkpoint applies subsequent random transforms in
+   * different frames than this one does. Pending proposals are not saved, but drawn again on resuming.
+   */
+  void export_bin(const std::string &path) const override;
+
   /** @brief Export tree to GraphViz format. */
   void todot(const std::string &path) const;
 
 private:
-  std::unique_ptr<walk_node<Dim, Simd>> root_;
-  std::mt19937 rng_;
-  std::uniform_int_distribution<int> dist_; // distribution for choosing a random lattice site
-  walk_node<Dim, Simd> *buf_;               // buffer into which nodes are allocated (used for fast node lookup by id)
+  /** @brief A random pivot proposal together with the outcome of its intersection test. */
+  struct proposal {
+    int site;
+    transform<Dim, Simd> symm;
+    bool tested;
+    bool accepted;
+  };
+
+  walk_node<Dim, Simd> *root_;
+  proposal_queue<Dim, Simd> queue_;
+
+  // Arena holding the leaf sentinel at index 0, the node with id n at index n / leaf_size_ (used for fast node lookup
+  // by id), the leaves holding more than one site (see walk_node::balanced_rep) and, after those, one block of scratch
+  // slots per thread testing pivots about sites inside a leaf.
+  walk_node<Dim, Simd> *buf_;
+  int num_slots_{};   // number of slots in buf_ before the scratch blocks
+  int num_scratch_{}; // number of scratch blocks in buf_
+  bool balanced_;
+  int leaf_size_;
+
+  // Only used when rebalancing lazily (see set_rebalance_slack): the index in buf_ of the node with id k * leaf_size_
+  // for each k, which otherwise is k, and the height above which the tree is rebalanced.
+  std::vector<int> slots_;
+  int max_height_{};
+
+  std::unique_ptr<worker_pool> pool_;
+  std::vector<proposal> proposals_; // pending proposals, in the order in which they were drawn
+  size_t next_proposal_{};          // index in proposals_ of the next proposal to be consumed
+
+  /** @brief Returns the streams of the walk from the next proposal on, including pending ones. */
+  proposal_streams streams() const;
+
+  /** @brief Number of slots in a scratch block, i.e. room to split a leaf if leaves hold more than one site. */
+  int scratch_size() const;
+
+  /** @brief Returns the number of blocks of sites held by leaves. */
+  int num_blocks() const;
+
+  /** @brief Returns the sum of the positions of the sites of the walk and the sum of their squared norms. */
+  std::pair<std::array<double, Dim>, double> moments() const;
+
+  /** @brief Returns the node with id block * leaf_size_, or the sentinel for block 0. */
+  walk_node<Dim, Simd> *block_node(int block) const;
+
+  /**
+   * @brief Shuffles the node with the given id up to the root of the given subtree, keeping slots_ up to date.
+   *
+   * @param node Root of the subtree.
+   * @param start Index of the first site of the subtree in the walk.
+   * @param id Id of the node, relative to the start of the subtree.
+   */
+  void shuffle_up(walk_node<Dim, Simd> *node, int start, int id);
+
+  /** @brief Rebalances the tree after shuffling up a node, either fully or only if it has grown too tall. */
+  void settle();
+
+  /** @brief Rebalances the subtrees of the given subtree that are taller than balanced trees with as many sites. */
+  void rebalance(walk_node<Dim, Simd> *node, int start);
+
+  /** @brief Returns the given block of scratch slots for test_pivot_fast. */
+  walk_node<Dim, Simd> *scratch(int block) const;
+
+  /** @brief Reallocates the arena to hold at least the given number of scratch blocks. */
+  void reserve_scratch(int num_blocks);
+
+  /**
+   * @brief Checks whether a pivot would succeed without modifying the tree. Safe to call concurrently, as long as each
+   * thread uses its own block of scratch slots, which are only needed to split a leaf.
+   */
+  bool test_pivot_fast(int n, const transform<Dim, Simd> &t, walk_node<Dim, Simd> *scratch);
+
+  /** @brief Returns the parent of the leaf holding the given block of sites and whether the leaf is its left child. */
+  std::pair<walk_node<Dim, Simd> *, bool> leaf_parent(int block) const;
+
+  /** @brief Applies a pivot that is known to succeed. */
+  void do_pivot(int n, const transform<Dim, Simd> &t);
+
+  bool rand_pivot_parallel();
+
+  /** @brief Tops up the pending proposals and tests them concurrently up to the first accepted one. */
+  void test_proposals();
+
+  /**
+   * @brief Writes the given sites of the subtree to out, placed by the frame (offset, t) of the subtree.
+   *
+   * @param indices Indices of the sites in the walk, in non-decreasing order, where the subtree starts at site base.
+   */
+  void sites(const walk_node<Dim, Simd> *node, const point<Dim, Simd> &offset, const transform<Dim, Simd> &t,
+             std::span<const int> indices, int base, point<Dim, Simd> *out) const;
+
+  /**
+   * @brief Passes to emit(box, join) the bounding boxes of the pieces of the sites [lo, hi) of the subtree, cut before
+   * each of cuts, placed by the frame (offset, t) of the subtree. The first piece is to be joined to the last one
+   * emitted if join is set.
+   *
+   * @details Indices are those of sites in the walk, where the subtree starts at site base. Cuts lie strictly between
+   * lo and hi, in increasing order.
+   */
+  template <typename Emit>
+  void bboxes(const walk_node<Dim, Simd> *node, const point<Dim, Simd> &offset, const transform<Dim, Simd> &t, int lo,
+              int hi, std::span<const int> cuts, int base, bool join, Emit &emit) const;
 };
 
 } // namespace pivot
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pivot {
+
+/**
+ * @brief A fixed set of long-lived threads that repeatedly run a common task.
+ *
+ * The thread calling run() takes part as worker 0, so a pool of size n only spawns n - 1 threads.
+ */
+class worker_pool {
+
+public:
+  /** @param num_workers Number of workers, including the calling thread. Must be positive. */
+  explicit worker_pool(int num_workers);
+
+  worker_pool(const worker_pool &) = delete;
+  worker_pool &operator=(const worker_pool &) = delete;
+
+  /** @brief Stops and joins all worker threads. */
+  ~worker_pool();
+
+  int size() const { return num_workers_; }
+
+  /**
+   * @brief Runs task(i) on every worker i in [0, size()) and blocks until all of them have returned.
+   *
+   * @warning The task must not throw.
+   */
+  void run(const std::function<void(int)> &task);
+
+private:
+  int num_workers_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  const std::function<void(int)> *task_{};
+  unsigned long generation_{};
+  int running_{};
+  bool stop_{};
+
+  void work(int id);
+};
+
+} // namespace pivot
@@ -90,6 +90,11 @@ template <int Dim, bool Simd> box<Dim, Simd> box<Dim, Simd>::operator&(const box
   return box(intervals);
 }
 
+template <int Dim, bool Simd>
+std::array<bool, 2> box<Dim, Simd>::disjoint(const box<Dim, Simd> &b1, const box<Dim, Simd> &b2) const {
+  return {(*this & b1).empty(), (*this & b2).empty()};
+}
+
 template <int Dim, bool Simd> std::string box<Dim, Simd>::to_string() const {
   std::string s = "";
   for (int i = 0; i < Dim - 1; ++i) {
@@ -2,77 +2,111 @@
 
 namespace pivot {
 
-box<2, true> &box<2, true>::operator+=(const point<2, true> &p) {
-  __m128i offset = _mm_shuffle_epi32(p.data(), _MM_SHUFFLE(1, 0, 1, 0));
-  data_ = _mm_add_epi32(data_, offset);
-  return *this;
-}
-
-box<2, true> &box<2, true>::operator-=(const point<2, true> &b) {
-  __m128i offset = _mm_shuffle_epi32(b.data(), _MM_SHUFFLE(1, 0, 1, 0));
-  data_ = _mm_sub_epi32(data_, offset);
-  return *this;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true>::box(const std::array<interval, Dim> &intervals) {
+  std::array<int, Dim> lower;
+  std::array<int, Dim> upper;
+  for (int i = 0; i < Dim; ++i) {
+    lower[i] = intervals[i].left_;
+    upper[i] = intervals[i].right_;
+  }
+  data_ = join_halves(load_epi32<lanes / 2>(lower), load_epi32<lanes / 2>(upper));
 }
 
-box<2, true>::box(const std::array<interval, 2> &intervals)
-    : data_(_mm_setr_epi32(intervals[0].left_, intervals[1].left_, intervals[0].right_, intervals[1].right_)) {}
-
-box<2, true>::box(std::span<const point<2, true>> points) {
-  std::array<int, 2> min;
-  std::array<int, 2> max;
-  min.fill(std::numeric_limits<int>::max());
-  max.fill(std::numeric_limits<int>::min());
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true>::box(std::span<const point<Dim, true>> points) {
+  using half = simd_int_t<lanes / 2>;
+  half min = set1_epi32<lanes / 2>(std::numeric_limits<int>::max());
+  half max = set1_epi32<lanes / 2>(std::numeric_limits<int>::min());
   for (const auto &p : points) {
-    for (int i = 0; i < 2; ++i) { // TODO: vectorize (not urgent)
-      min[i] = std::min(min[i], p[i]);
-      max[i] = std::max(max[i], p[i]);
-    }
+    min = min_epi32(min, p.data());
+    max = max_epi32(max, p.data());
   }
   // anchor at (1, 0, ..., 0)
-  data_ = insert_epi32(data_, min[0] - points[0][0] + 1, 0);
-  data_ = insert_epi32(data_, max[0] - points[0][0] + 1, 2);
-  data_ = insert_epi32(data_, min[1] - points[0][1], 1);
-  data_ = insert_epi32(data_, max[1] - points[0][1], 3);
+  half offset = sub_epi32(point<Dim, true>::unit(0).data(), points[0].data());
+  data_ = join_halves(add_epi32(min, offset), add_epi32(max, offset));
 }
 
-bool box<2, true>::operator==(const box &b) const {
-  return _mm_movemask_epi8(_mm_cmpeq_epi32(data_, b.data_)) == 0xFFFF;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+std::array<interval, Dim> box<Dim, true>::intervals() const {
+  auto bounds = store_epi32(data_);
+  std::array<interval, Dim> result;
+  for (int i = 0; i < Dim; ++i) {
+    result[i] = interval(bounds[i], bounds[lanes / 2 + i]);
+  }
+  return result;
 }
 
-bool box<2, true>::operator!=(const box &b) const { return !(*this == b); }
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool box<Dim, true>::operator==(const box &b) const {
+  return all_eq_epi32(data_, b.data_);
+}
 
-interval box<2, true>::operator[](int i) const {
-  return {int32_t(extract_epi32(data_, i)), int32_t(extract_epi32(data_, i + 2))};
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool box<Dim, true>::operator!=(const box &b) const {
+  return !(*this == b);
 }
 
-bool box<2, true>::empty() const {
-  __m128i swapped = _mm_shuffle_epi32(data_, _MM_SHUFFLE(1, 0, 3, 2));
-  __m128i cmp = _mm_cmpgt_epi32(data_, swapped);
-  auto result = _mm_cvtsi128_si64(cmp); // Only check the lower 64 bits
-  return result != 0;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+interval box<Dim, true>::operator[](int i) const {
+  auto bounds = store_epi32(data_);
+  return {bounds[i], bounds[lanes / 2 + i]};
 }
 
-box<2, true> box<2, true>::operator|(const box<2, true> &b) const {
-  // TODO: Look into using `_mm_maskz_{min,max}_epi32`
-  // For example: `__m128i mins = _mm_min_epi32(0b0011, data, b.data)`
-  // For now, benchmarks are crashing when I enable AVX512 in the build
-  __m128i mins = _mm_min_epi32(data_, b.data_);
-  __m128i maxs = _mm_max_epi32(data_, b.data_);
-  return _mm_blend_epi32(mins, maxs, 0b1100);
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool box<Dim, true>::empty() const {
+  return any_gt_epi32(lower_half(data_), upper_half(data_));
 }
 
-box<2, true> box<2, true>::operator&(const box<2, true> &b) const {
-  // TODO: See comment under `operator|`
-  __m128i mins = _mm_min_epi32(data_, b.data_);
-  __m128i maxs = _mm_max_epi32(data_, b.data_);
-  return _mm_blend_epi32(mins, maxs, 0b0011);
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true> &box<Dim, true>::operator+=(const point<Dim, true> &p) {
+  data_ = add_epi32(data_, broadcast_halves(p.data()));
+  return *this;
 }
 
-std::string box<2, true>::to_string() const {
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true> &box<Dim, true>::operator-=(const point<Dim, true> &p) {
+  data_ = sub_epi32(data_, broadcast_halves(p.data()));
+  return *this;
+}
+
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true> box<Dim, true>::operator|(const box &b) const {
+  return blend_halves(min_epi32(data_, b.data_), max_epi32(data_, b.data_));
+}
+
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true> box<Dim, true>::operator&(const box &b) const {
+  return blend_halves(max_epi32(data_, b.data_), min_epi32(data_, b.data_));
+}
+
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+std::array<bool, 2> box<Dim, true>::disjoint(const box &b1, const box &b2) const {
+  return {(*this & b1).empty(), (*this & b2).empty()};
+}
+
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+std::string box<Dim, true>::to_string() const {
   std::string s = "";
-  s += interval(extract_epi32(data_, 0), extract_epi32(data_, 2)).to_string();
-  s += " x ";
-  s += interval(extract_epi32(data_, 1), extract_epi32(data_, 3)).to_string();
+  for (int i = 0; i < Dim; ++i) {
+    s += (*this)[i].to_string();
+    if (i < Dim - 1) {
+      s += " x ";
+    }
+  }
   return s;
 }
 
@@ -2,30 +2,28 @@
 
 #include "box.hpp"
 #include "lattice.h"
+#include "philox.h"
 #include "point.hpp"
 #include "transform.hpp"
 
-#ifdef ENABLE_AVX2
-#include "box_simd.hpp"
-#include "point_simd.hpp"
-#include "transform_simd.hpp"
-#endif
-
 namespace pivot {
 
+point_hash::point_hash(int num_steps) : num_steps_(num_steps) {}
+
 #define BOX_INST(z, n, data) template struct box<n>;
 #define POINT_INST(z, n, data) template class point<n>;
 #define POINT_HASH_CALL_INST(z, n, data) template std::size_t point_hash::operator()<n>(const point<n> &p) const;
 #define TRANSFORM_INST(z, n, data) template class transform<n>;
+// also declared extern in lattice_simd.h, so that the SIMD units call these copies
+#define LATTICE_HELPERS_INST(z, n, data)                                                                               \
+  template std::string matrix_to_string<n>(const std::array<std::array<int, n>, n> &matrix);                          \
+  template void rand_signed_perm<n, philox>(philox &gen, std::array<int, n> &perm, std::array<int, n> &signs);
 
 // cppcheck-suppress syntaxError
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, BOX_INST, ~)
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, POINT_INST, ~)
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, POINT_HASH_CALL_INST, ~)
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, TRANSFORM_INST, ~)
-
-#ifdef ENABLE_AVX2
-template std::size_t point_hash::operator()<2>(const point<2, true> &p) const;
-#endif
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, LATTICE_HELPERS_INST, ~)
 
 } // namespace pivot
@@ -2,42 +2,74 @@
 
 namespace pivot {
 
-point<2, true>::point() : coords_(_mm_setzero_si128()) {}
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true>::point() : coords_(set1_epi32<lanes>(0)) {}
 
-point<2, true>::point(__m128i coords) : coords_(coords) {}
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true>::point(vec coords) : coords_(coords) {}
 
-point<2, true>::point(const std::array<int, 2> &coords) : coords_(_mm_setr_epi32(coords[0], coords[1], 0, 0)) {}
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true>::point(const std::array<int, Dim> &coords) : coords_(load_epi32<lanes>(coords)) {}
 
-point<2, true> point<2, true>::unit(int i) {
-  point p;
-  p.coords_ = insert_epi32(p.coords_, 1, i);
-  return p;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true> point<Dim, true>::unit(int i) {
+  std::array<int, Dim> coords{};
+  coords[i] = 1;
+  return point(coords);
 }
 
-int point<2, true>::operator[](int i) const { return extract_epi32(coords_, i); }
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+int point<Dim, true>::operator[](int i) const {
+  return store_epi32(coords_)[i];
+}
 
-bool point<2, true>::operator==(const point &p) const {
-  return _mm_movemask_epi8(_mm_cmpeq_epi32(coords_, p.coords_)) == 0xFFFF;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool point<Dim, true>::operator==(const point &p) const {
+  return all_eq_epi32(coords_, p.coords_);
 }
 
-bool point<2, true>::operator!=(const point &p) const { return !(*this == p); }
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool point<Dim, true>::operator!=(const point &p) const {
+  return !(*this == p);
+}
 
-point<2, true> point<2, true>::operator+(const point<2, true> &p) const { return _mm_add_epi32(coords_, p.coords_); }
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true> point<Dim, true>::operator+(const point &p) const {
+  return add_epi32(coords_, p.coords_);
+}
 
-point<2, true> point<2, true>::operator-(const point &p) const { return _mm_sub_epi32(coords_, p.coords_); }
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true> point<Dim, true>::operator-(const point &p) const {
+  return sub_epi32(coords_, p.coords_);
+}
 
-point<2, true> &point<2, true>::operator*=(int k) {
-  coords_ = _mm_mullo_epi32(coords_, _mm_set1_epi32(k));
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true> &point<Dim, true>::operator*=(int k) {
+  coords_ = mullo_epi32(coords_, set1_epi32<lanes>(k));
   return *this;
 }
 
-// int point<2, true>::norm() const;
-
-std::string point<2, true>::to_string() const {
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+std::string point<Dim, true>::to_string() const {
+  auto coords = store_epi32(coords_);
   std::string s = "(";
-  s += std::to_string(extract_epi32(coords_, 0));
-  s += ", ";
-  s += std::to_string(extract_epi32(coords_, 1));
+  for (int i = 0; i < Dim; ++i) {
+    s += std::to_string(coords[i]);
+    if (i < Dim - 1) {
+      s += ", ";
+    }
+  }
   s += ")";
   return s;
 }
@@ -1,9 +1,30 @@
+#include <cstdint>
+#include <numeric>
+
 #include <boost/preprocessor/repetition/repeat_from_to.hpp>
 
 #include "lattice.h"
 
 namespace pivot {
 
+template <int Dim> std::string matrix_to_string(const std::array<std::array<int, Dim>, Dim> &matrix) {
+  std::string s = "[";
+  for (int i = 0; i < Dim; ++i) {
+    s += "[";
+    for (int j = 0; j < Dim - 1; ++j) {
+      s += std::to_string(matrix[i][j]) + ", ";
+    }
+    s += std::to_string(matrix[i][Dim - 1]) + "]";
+    if (i < Dim - 1) {
+      s += ", ";
+    }
+  }
+  s += "]";
+  return s;
+}
+
+/* GENERIC TRANSFORMS */
+
 template <int Dim, bool Simd> transform<Dim, Simd>::transform() {
   for (int i = 0; i < Dim; ++i) {
     perm_[i] = i;  // trivial permutation
@@ -41,8 +62,7 @@ transform<Dim, Simd>::transform(const point<Dim, Simd> &p, const point<Dim, Simd
 }
 
 template <int Dim, bool Simd> transform<Dim, Simd> transform<Dim, Simd>::rand() {
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
+  thread_local philox gen(std::random_device{}());
   return rand(gen);
 }
 
@@ -107,20 +127,223 @@ template <int Dim, bool Simd> std::array<std::array<int, Dim>, Dim> transform<Di
 }
 
 template <int Dim, bool Simd> std::string transform<Dim, Simd>::to_string() const {
-  auto matrix = to_matrix();
-  std::string s = "[";
-  for (int i = 0; i < Dim; ++i) {
-    s += "[";
-    for (int j = 0; j < Dim - 1; ++j) {
-      s += std::to_string(matrix[i][j]) + ", ";
+  return matrix_to_string<Dim>(to_matrix());
+}
+
+/* TABULATED TRANSFORMS */
+
+/** @brief Permutations, signs, products and inverses of the elements of the symmetry group of the cubic lattice. */
+template <int Dim> struct cayley_table {
+  static constexpr int num_signs = 1 << Dim;
+  static constexpr int num_perms = [] {
+    int factorial = 1;
+    for (int i = 2; i <= Dim; ++i) {
+      factorial *= i;
     }
-    s += std::to_string(matrix[i][Dim - 1]) + "]";
-    if (i < Dim - 1) {
-      s += ", ";
+    return factorial;
+  }();
+  static constexpr int order = num_signs * num_perms;
+
+  std::array<std::array<std::int8_t, Dim>, order> perm{};
+  std::array<std::array<std::int8_t, Dim>, order> signs{};
+  std::uint16_t product[order][order]{}; // built-in array to keep compile-time evaluation within GCC's limits
+  std::array<std::uint16_t, order> inverse{};
+
+  /** @brief Returns the lexicographic rank of a permutation. */
+  static constexpr int rank(const std::array<int, Dim> &perm) {
+    int result = 0;
+    for (int i = 0; i < Dim; ++i) {
+      int num_smaller = 0;
+      for (int j = i + 1; j < Dim; ++j) {
+        num_smaller += perm[j] < perm[i];
+      }
+      result = result * (Dim - i) + num_smaller;
     }
+    return result;
   }
-  s += "]";
-  return s;
+
+  /** @brief Returns the index of the element with the given permutation and signs (see transform<Dim, false>). */
+  static constexpr std::uint16_t index(const std::array<int, Dim> &perm, const std::array<int, Dim> &signs) {
+    int bits = 0;
+    for (int i = 0; i < Dim; ++i) {
+      bits |= (signs[i] < 0) << i;
+    }
+    return rank(perm) * num_signs + bits;
+  }
+
+  constexpr cayley_table() {
+    // enumerate permutations in lexicographic order
+    std::array<std::array<int, Dim>, num_perms> perms;
+    std::array<int, Dim> p;
+    std::iota(p.begin(), p.end(), 0);
+    for (int r = 0; r < num_perms; ++r) {
+      perms[r] = p;
+      std::next_permutation(p.begin(), p.end());
+    }
+
+    for (int a = 0; a < order; ++a) {
+      for (int i = 0; i < Dim; ++i) {
+        perm[a][i] = perms[a / num_signs][i];
+        signs[a][i] = (a >> i) & 1 ? -1 : 1;
+      }
+    }
+
+    // see transform<Dim, Simd>::inverse()
+    for (int a = 0; a < order; ++a) {
+      std::array<int, Dim> inv_perm;
+      std::array<int, Dim> inv_signs;
+      for (int i = 0; i < Dim; ++i) {
+        inv_perm[perm[a][i]] = i;
+        inv_signs[i] = signs[a][perm[a][i]];
+      }
+      inverse[a] = index(inv_perm, inv_signs);
+    }
+
+    /* See transform<Dim, Simd>::operator*(const transform &). The product of (P1, S1) and (P2, S2) has permutation
+    P1 P2 and its sign at P1(j) is S1(P1(j)) S2(j), so its sign bits are those of S1 XORed with those of S2 moved by
+    P1. Tabulating both parts separately keeps compile-time evaluation cheap. */
+    int perm_product[num_perms][num_perms]{};
+    int moved_bits[num_perms][num_signs]{};
+    for (int r1 = 0; r1 < num_perms; ++r1) {
+      for (int r2 = 0; r2 < num_perms; ++r2) {
+        std::array<int, Dim> prod;
+        for (int i = 0; i < Dim; ++i) {
+          prod[i] = perms[r1][perms[r2][i]];
+        }
+        perm_product[r1][r2] = rank(prod);
+      }
+      for (int bits = 0; bits < num_signs; ++bits) {
+        moved_bits[r1][bits] = 0;
+        for (int j = 0; j < Dim; ++j) {
+          moved_bits[r1][bits] |= ((bits >> j) & 1) << perms[r1][j];
+        }
+      }
+    }
+    for (int a = 0; a < order; ++a) {
+      const int *prod_row = perm_product[a / num_signs];
+      const int *bits_row = moved_bits[a / num_signs];
+      for (int b = 0; b < order; ++b) {
+        product[a][b] = prod_row[b / num_signs] * num_signs + ((a % num_signs) ^ bits_row[b % num_signs]);
+      }
+    }
+  }
+};
+
+template <int Dim> constexpr cayley_table<Dim> cayley_table_v{};
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+transform<Dim, false>::transform() : index_(0) {}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+transform<Dim, false>::transform(const std::array<int, Dim> &perm, const std::array<int, Dim> &signs)
+    : index_(cayley_table<Dim>::index(perm, signs)) {}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+transform<Dim, false>::transform(const point<Dim, false> &p, const point<Dim, false> &q) {
+  point<Dim, false> diff = q - p;
+  int idx = -1;
+  for (int i = 0; i < Dim; ++i) {
+    if (std::abs(diff[i]) == 1) {
+      if (idx == -1) {
+        idx = i;
+      } else {
+        throw std::invalid_argument("Points are not adjacent");
+      }
+    }
+  }
+  if (idx == -1) {
+    throw std::invalid_argument("Points are not adjacent");
+  }
+
+  std::array<int, Dim> perm;
+  std::array<int, Dim> signs;
+  for (int i = 0; i < Dim; ++i) {
+    perm[i] = i;
+    signs[i] = 1;
+  }
+  perm[0] = idx;
+  perm[idx] = 0;
+  signs[0] = -diff[idx];
+  signs[idx] = diff[idx];
+  index_ = cayley_table<Dim>::index(perm, signs);
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+transform<Dim, false> transform<Dim, false>::rand() {
+  thread_local philox gen(std::random_device{}());
+  return rand(gen);
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+bool transform<Dim, false>::operator==(const transform &t) const {
+  return index_ == t.index_;
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+point<Dim, false> transform<Dim, false>::operator*(const point<Dim, false> &p) const {
+  const auto &perm = cayley_table_v<Dim>.perm[index_];
+  const auto &signs = cayley_table_v<Dim>.signs[index_];
+  std::array<int, Dim> coords;
+  for (int i = 0; i < Dim; ++i) {
+    coords[perm[i]] = signs[perm[i]] * p[i];
+  }
+  return point<Dim, false>(coords);
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+transform<Dim, false> transform<Dim, false>::operator*(const transform<Dim, false> &t) const {
+  return transform(cayley_table_v<Dim>.product[index_][t.index_]);
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+box<Dim, false> transform<Dim, false>::operator*(const box<Dim, false> &b) const {
+  const auto &perm = cayley_table_v<Dim>.perm[index_];
+  const auto &signs = cayley_table_v<Dim>.signs[index_];
+  std::array<interval, Dim> intervals;
+  for (int i = 0; i < Dim; ++i) {
+    int x = signs[perm[i]] * b.intervals_[i].left_;
+    int y = signs[perm[i]] * b.intervals_[i].right_;
+    intervals[perm[i]] = interval(std::min(x, y), std::max(x, y));
+  }
+  return box<Dim, false>(intervals);
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+bool transform<Dim, false>::is_identity() const {
+  return index_ == 0;
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+transform<Dim, false> transform<Dim, false>::inverse() const {
+  return transform(cayley_table_v<Dim>.inverse[index_]);
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+std::array<std::array<int, Dim>, Dim> transform<Dim, false>::to_matrix() const {
+  const auto &perm = cayley_table_v<Dim>.perm[index_];
+  const auto &signs = cayley_table_v<Dim>.signs[index_];
+  std::array<std::array<int, Dim>, Dim> matrix = {};
+  for (int i = 0; i < Dim; ++i) {
+    matrix[perm[i]][i] = signs[perm[i]];
+  }
+  return matrix;
+}
+
+template <int Dim>
+  requires(Dim < transform_table_dims_ub)
+std::string transform<Dim, false>::to_string() const {
+  return matrix_to_string<Dim>(to_matrix());
 }
 
 } // namespace pivot
@@ -2,16 +2,28 @@
 
 namespace pivot {
 
-transform<2, true>::transform() : perm_(_mm_setr_epi32(0, 1, 2, 3)), signs_(_mm_set1_epi32(1)) {}
-
-transform<2, true>::transform(const std::array<int, 2> &perm, const std::array<int, 2> &signs)
-    : perm_(_mm_setr_epi32(perm[0], perm[1], 2 + perm[0], 2 + perm[1])),
-      signs_(_mm_setr_epi32(signs[0], signs[1], signs[0], signs[1])) {}
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+transform<Dim, true>::transform() : perm_(iota_epi32<lanes>()), signs_(set1_epi32<lanes>(1)) {}
+
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+transform<Dim, true>::transform(const std::array<int, Dim> &perm, const std::array<int, Dim> &signs) {
+  std::array<int, lanes> inverse;
+  std::iota(inverse.begin(), inverse.end(), 0);
+  for (int i = 0; i < Dim; ++i) {
+    inverse[perm[i]] = i;
+  }
+  perm_ = load_epi32<lanes>(inverse);
+  signs_ = load_epi32<lanes>(signs, 1);
+}
 
-transform<2, true>::transform(const point<2, true> &p, const point<2, true> &q) : transform() {
-  point<2, true> diff = q - p;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+transform<Dim, true>::transform(const point<Dim, true> &p, const point<Dim, true> &q) : transform() {
+  point<Dim, true> diff = q - p;
   int idx = -1;
-  for (int i = 0; i < 2; ++i) {
+  for (int i = 0; i < Dim; ++i) {
     if (std::abs(diff[i]) == 1) {
       if (idx == -1) {
         idx = i;
@@ -24,85 +36,81 @@ transform<2, true>::transform(const point<2, true> &p, const point<2, true> &q)
     throw std::invalid_argument("Points are not adjacent");
   }
 
-  perm_ = insert_epi32(perm_, idx, 0);
-  perm_ = insert_epi32(perm_, 0, idx);
-  signs_ = insert_epi32(signs_, -diff[idx], 0);
-  signs_ = insert_epi32(signs_, diff[idx], idx);
-
-  // TODO: clean this up
-  perm_ = insert_epi32(perm_, idx + 2, 2);
-  perm_ = insert_epi32(perm_, 2, idx + 2);
-  signs_ = insert_epi32(signs_, -diff[idx], 2);
-  signs_ = insert_epi32(signs_, diff[idx], idx + 2);
+  // swapping two axes is its own inverse
+  auto perm = store_epi32(perm_);
+  auto signs = store_epi32(signs_);
+  perm[0] = idx;
+  perm[idx] = 0;
+  signs[0] = -diff[idx];
+  signs[idx] = diff[idx];
+  perm_ = load_epi32<lanes>(perm);
+  signs_ = load_epi32<lanes>(signs);
 }
 
-transform<2, true> transform<2, true>::rand() {
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+transform<Dim, true> transform<Dim, true>::rand() {
+  thread_local philox gen(std::random_device{}());
   return rand(gen);
 }
 
-bool transform<2, true>::operator==(const transform &t) const {
-  return _mm_movemask_epi8(_mm_cmpeq_epi32(signs_, t.signs_)) == 0xFFFF &&
-         _mm_movemask_epi8(_mm_cmpeq_epi32(perm_, t.perm_)) == 0xFFFF;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool transform<Dim, true>::operator==(const transform &t) const {
+  return all_eq_epi32(signs_, t.signs_) && all_eq_epi32(perm_, t.perm_);
 }
 
-point<2, true> transform<2, true>::operator*(const point<2, true> &p) const {
-  return _mm_sign_epi32(permutevar_epi32(p.data(), perm_), signs_);
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+point<Dim, true> transform<Dim, true>::operator*(const point<Dim, true> &p) const {
+  return sign_epi32(permutevar_epi32(p.data(), perm_), signs_);
 }
 
-transform<2, true> transform<2, true>::operator*(const transform<2, true> &t) const {
-  __m128i perm = permutevar_epi32(perm_, t.perm_);
-  __m128i signs = _mm_sign_epi32(permutevar_epi32(t.signs_, perm_), signs_);
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+transform<Dim, true> transform<Dim, true>::operator*(const transform &t) const {
+  // The j-th component of the image of p is S1(j) S2(P1^-1(j)) p[P2^-1(P1^-1(j))]
+  vec perm = permutevar_epi32(t.perm_, perm_);
+  vec signs = sign_epi32(permutevar_epi32(t.signs_, perm_), signs_);
   return {perm, signs};
 }
 
-box<2, true> transform<2, true>::operator*(const box<2, true> &b) const {
-  __m128i pairs = _mm_sign_epi32(permutevar_epi32(b.data(), perm_), signs_);
-  return sort_bounds(pairs);
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+box<Dim, true> transform<Dim, true>::operator*(const box<Dim, true> &b) const {
+  return sort_halves(sign_halves(permute_halves(b.data(), perm_), signs_));
 }
 
-bool transform<2, true>::is_identity() const {
-  return _mm_movemask_epi8(_mm_cmpeq_epi32(signs_, _mm_set1_epi32(1))) == 0xFFFF &&
-         _mm_movemask_epi8(_mm_cmpeq_epi32(perm_, _mm_setr_epi32(0, 1, 2, 3))) == 0xFFFF;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+bool transform<Dim, true>::is_identity() const {
+  return all_eq_epi32(signs_, set1_epi32<lanes>(1)) && all_eq_epi32(perm_, iota_epi32<lanes>());
 }
 
-transform<2, true> transform<2, true>::inverse() const {
-  // In general, the inverse is given by signs S' and permutations P' such
-  // that P' = P^-1 and S' = S P. The latter's components can be obtained by
-  // viewing S as a vector and applying P to it (i.e. permuting it). Moreover,
-  // in 2D, P^-1 is the same as P.
-  return transform(perm_, permutevar_epi32(signs_, perm_));
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+transform<Dim, true> transform<Dim, true>::inverse() const {
+  // The inverse has permutation P^-1 and signs S(P(i)) (see the generic transform), so the lanes of its perm_ hold P
+  vec perm = invert_permutation(perm_);
+  return transform(perm, permutevar_epi32(signs_, perm));
 }
 
-std::array<std::array<int, 2>, 2> transform<2, true>::to_matrix() const {
-  std::array<std::array<int, 2>, 2> mat = {{{0, 0}, {0, 0}}};
-  for (int i = 0; i < 2; ++i) {
-    int p = extract_epi32(perm_, i);
-    mat[p][i] = extract_epi32(signs_, p);
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+std::array<std::array<int, Dim>, Dim> transform<Dim, true>::to_matrix() const {
+  auto perm = store_epi32(perm_);
+  auto signs = store_epi32(signs_);
+  std::array<std::array<int, Dim>, Dim> mat{};
+  for (int j = 0; j < Dim; ++j) {
+    mat[j][perm[j]] = signs[j];
   }
   return mat;
 }
 
-// TODO: double-check
-std::string transform<2, true>::to_string() const {
-  auto mat = to_matrix();
-  std::string s = "[";
-  for (int i = 0; i < 2; ++i) {
-    s += "[";
-    for (int j = 0; j < 2; ++j) {
-      s += std::to_string(mat[i][j]);
-      if (j < 1) {
-        s += ", ";
-      }
-    }
-    s += "]";
-    if (i < 1) {
-      s += ", ";
-    }
-  }
-  s += "]";
-  return s;
+template <int Dim>
+  requires(Dim > 2 && Dim < SIMD_DIMS_UB)
+std::string transform<Dim, true>::to_string() const {
+  return matrix_to_string<Dim>(to_matrix());
 }
 
-} // namespace pivot
\ No newline at end of file
+} // namespace pivot
@@ -1,72 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <random>
 #include <string>
 
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+
+#include "counters.h"
+#include "dimerize.h"
+#include "sample_sink.h"
 #include "utils.h"
 #include "walk.h"
 #include "walk_tree.h"
 
-template <int Dim, bool Simd = false>
-int main_loop(int num_steps, int iters, bool naive, bool fast, int seed, bool require_success, bool verify,
-              const std::string &in_path, const std::string &out_dir) {
-  std::unique_ptr<pivot::walk_base<Dim, Simd>> w;
-  if (naive) {
-    if (in_path.empty()) {
-      w = std::make_unique<pivot::walk<Dim, Simd>>(num_steps, seed);
-    } else {
-      w = std::make_unique<pivot::walk<Dim, Simd>>(in_path, seed);
-    }
-  } else {
-    if (in_path.empty()) {
-      w = std::make_unique<pivot::walk_tree<Dim, Simd>>(num_steps, seed);
-    } else {
-      w = std::make_unique<pivot::walk_tree<Dim, Simd>>(in_path, seed);
-    }
+/**
+ * @brief Options of a run of the pivot algorithm, meant to be set with designated initializers, e.g.
+ * `main_loop<2>(100, 10, {.seed = 42, .verify = true})`.
+ */
+struct loop_options {
+  /** @brief Whether to use the naive implementation (walk) rather than the saw-tree (walk_tree). */
+  bool naive = false;
+  /** @brief Whether to test pivots with the fast variant of the implementation. */
+  bool fast = true;
+  /** @brief Seed (default: restored from a binary checkpoint, or random). */
+  std::optional<unsigned int> seed = std::nullopt;
+  /** @brief Whether to count successful pivots rather than attempts towards the number of iterations. */
+  bool require_success = false;
+  /** @brief Whether to check that the walk is self-avoiding at the end of the run. */
+  bool verify = false;
+  /** @brief Path of the initial walk (CSV file or binary checkpoint), or empty to start from a straight line. */
+  std::string in_path = "";
+  /** @brief Directory in which the walk and endpoints are saved, or empty to save nothing. */
+  std::string out_dir = "";
+  /** @brief Number of threads testing pivot proposals. */
+  int num_workers = 0;
+  /** @brief Number of sites held by each leaf of the saw-tree. */
+  int leaf_size = 1;
+  /** @brief Number of levels the saw-tree may grow past balanced before it is rebalanced. */
+  int rebalance_slack = 0;
+  /** @brief Whether to save the walk and endpoints in binary rather than CSV. */
+  bool save_bin = false;
+  /** @brief Only save the endpoint of every k-th accepted walk. */
+  int sample_every = 1;
+  /** @brief Whether to start from a pseudo-dimerized walk rather than a straight line. */
+  bool dimerize = false;
+};
+
+/**
+ * @brief Runs the pivot algorithm on the given walk, printing progress and streaming the endpoints of accepted walks.
+ *
+ * Pivots are attempted in batches through Walk::run, which keeps the bookkeeping of this loop out of the attempts.
+ */
+template <int Dim, bool Simd, class Walk>
+int pivot_loop(Walk &w, int iters, const loop_options &options) {
+  // endpoints of accepted walks are streamed to disk as the run progresses
+  std::unique_ptr<pivot::file_sink<Dim, Simd>> endpoints;
+  if (!options.out_dir.empty()) {
+    endpoints = std::make_unique<pivot::file_sink<Dim, Simd>>(
+        options.out_dir + (options.save_bin ? "/endpoints.bin" : "/endpoints.csv"), options.save_bin,
+        options.sample_every);
   }
-  std::cerr << "Initialized walk with " << num_steps << " steps\n";
 
-  std::vector<pivot::point<Dim, Simd>> endpoints;
-  if (require_success) {
-    endpoints.reserve(iters);
+#ifdef ENABLE_COUNTERS
+  // the counters of the saw-tree primitives are reported at the end of each interval, and saved as JSON lines
+  std::ofstream counters_file;
+  if (!options.out_dir.empty()) {
+    counters_file.open(options.out_dir + "/counters.jsonl");
   }
+  pivot::collect_counters();
+  auto report_counters = [&counters_file] {
+    auto json = pivot::collect_counters().to_json();
+    std::cout << "Counters: " << json << std::endl;
+    if (counters_file) {
+      counters_file << json << '\n';
+    }
+  };
+#endif
 
-  int num_success = 0;
   int total_success = 0;
   int num_iter = 0;
   auto interval = static_cast<int>(std::pow(10, std::floor(std::log10(std::max(iters / 10, 1)))));
-  while (true) {
-    if (num_iter % interval == 0) {
-      std::cout << "Iterations: " << num_iter << " / Successes: " << total_success
-                << " / Success rate: " << num_success / static_cast<float>(interval) << std::endl;
-      num_success = 0;
-    }
-    if (require_success) {
-      if (total_success == iters) {
+  auto loop = [&](auto &&observer) {
+    int num_success = 0;
+    while (true) {
+      if (num_iter % interval == 0) {
+        std::cout << "Iterations: " << num_iter << " / Successes: " << total_success
+                  << " / Success rate: " << num_success / static_cast<float>(interval) << std::endl;
+        num_success = 0;
+#ifdef ENABLE_COUNTERS
+        if (num_iter > 0) {
+          report_counters();
+        }
+#endif
+      }
+      // a batch cannot succeed more often than it has attempts, so it never overshoots the required successes
+      int remaining = options.require_success ? iters - total_success : iters - num_iter;
+      if (remaining == 0) {
         break;
       }
-    } else if (num_iter == iters) {
-      break;
+      int batch = std::min(interval - num_iter % interval, remaining);
+      int batch_success = w.run(batch, observer, options.fast);
+      num_success += batch_success;
+      total_success += batch_success;
+      num_iter += batch;
     }
+  };
+  if (endpoints) {
+    loop([&endpoints](const Walk &w) { endpoints->push(w.endpoint()); });
+  } else {
+    loop([](const Walk &) {});
+  }
+#ifdef ENABLE_COUNTERS
+  if (num_iter % interval != 0) {
+    report_counters();
+  }
+#endif
 
-    auto success = w->rand_pivot(fast);
-    if (success) {
-      endpoints.push_back(w->endpoint());
-      ++num_success;
-      ++total_success;
+  if (!options.out_dir.empty()) {
+    std::cout << "Saving to: " << options.out_dir << '\n';
+    if (options.save_bin) {
+      w.export_bin(options.out_dir + "/walk.bin");
+    } else {
+      w.export_csv(options.out_dir + "/walk.csv");
     }
-    ++num_iter;
-  }
-  if (!out_dir.empty()) {
-    std::cout << "Saving to: " << out_dir << '\n';
-    w->export_csv(out_dir + "/walk.csv");
-    pivot::to_csv(out_dir + "/endpoints.csv", endpoints);
+    endpoints->close();
   }
-  if (verify) {
+  if (options.verify) {
     std::cout << "Verifying self-avoiding\n";
-    if (!w->self_avoiding()) {
+    if (!w.self_avoiding()) {
       std::cerr << "Walk is not self-avoiding\n";
       return 1;
     }
   }
   return 0;
 }
+
+/** @brief Runs the pivot algorithm on a walk with the given number of steps, or the walk in options.in_path. */
+template <int Dim, bool Simd = false> int main_loop(int num_steps, int iters, const loop_options &options = {}) {
+  auto seed = options.seed;
+  if (options.dimerize && options.in_path.empty()) {
+    // pseudo_dimerize draws from streams of the seed that pivot proposals never reach, so the walk can share it
+    seed = seed.value_or(std::random_device()());
+    std::cerr << "Pseudo-dimerizing initial walk\n";
+  }
+  if (options.naive) {
+    std::unique_ptr<pivot::walk<Dim, Simd>> walk;
+    if (options.in_path.empty() && options.dimerize) {
+      walk = std::make_unique<pivot::walk<Dim, Simd>>(
+          pivot::pseudo_dimerize<Dim, Simd>(num_steps, *seed, std::max(options.num_workers, 1)), seed);
+    } else if (options.in_path.empty()) {
+      walk = std::make_unique<pivot::walk<Dim, Simd>>(num_steps, seed);
+    } else {
+      walk = std::make_unique<pivot::walk<Dim, Simd>>(options.in_path, seed);
+    }
+    walk->set_num_workers(options.num_workers);
+    std::cerr << "Initialized walk with " << num_steps << " steps\n";
+    return pivot_loop<Dim, Simd>(*walk, iters, options);
+  }
+
+  std::unique_ptr<pivot::walk_tree<Dim, Simd>> tree;
+  if (options.in_path.empty() && options.dimerize) {
+    tree = std::make_unique<pivot::walk_tree<Dim, Simd>>(
+        pivot::pseudo_dimerize<Dim, Simd>(num_steps, *seed, std::max(options.num_workers, 1)), seed, true,
+        options.leaf_size);
+  } else if (options.in_path.empty()) {
+    tree = std::make_unique<pivot::walk_tree<Dim, Simd>>(num_steps, seed, true, options.leaf_size);
+  } else {
+    tree = std::make_unique<pivot::walk_tree<Dim, Simd>>(options.in_path, seed, true, options.leaf_size);
+  }
+  tree->set_num_workers(options.num_workers);
+  tree->set_rebalance_slack(options.rebalance_slack);
+  std::cerr << "Initialized walk with " << num_steps << " steps\n";
+  return pivot_loop<Dim, Simd>(*tree, iters, options);
+}
+
+#ifdef ENABLE_AVX2
+// SIMD instantiations are compiled separately with instruction set specific flags (see src/simd)
+#define MAIN_LOOP_SIMD_EXTERN(z, n, data)                                                                              \
+  extern template int main_loop<n, true>(int num_steps, int iters, const loop_options &options);
+
+// cppcheck-suppress syntaxError
+BOOST_PP_REPEAT_FROM_TO(2, SIMD_DIMS_UB, MAIN_LOOP_SIMD_EXTERN, ~)
+#endif
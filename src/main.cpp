@@ -2,15 +2,18 @@
 
 #include <boost/preprocessor/repeat_from_to.hpp>
 
+#include "dispatch.h"
 #include "loop.h"
-
-#ifdef ENABLE_AVX2
-#include "lattice_simd.h"
-#endif
+#include "walk_node.h"
 
 #define CASE_MACRO(z, n, data)                                                                                         \
   case n:                                                                                                              \
-    return main_loop<n>(num_steps, iters, naive, fast, seed, require_success, verify, in_path, out_dir);               \
+    return main_loop<n>(num_steps, iters, options);                                                                    \
+    break;
+
+#define SIMD_CASE_MACRO(z, n, data)                                                                                    \
+  case n:                                                                                                              \
+    return main_loop<n, true>(num_steps, iters, options);                                                              \
     break;
 
 int main(int argc, char **argv) {
@@ -20,12 +23,17 @@ int main(int argc, char **argv) {
   bool naive{false};
   std::optional<bool> fast_slow{std::nullopt};
   int num_workers{0};
+  int leaf_size{1};
+  int rebalance_slack{0};
   bool require_success{false};
   bool verify{false};
   std::string in_path{""};
   std::string out_dir{""};
-  unsigned int seed;
-  bool simd;
+  bool save_bin{false};
+  int sample_every{1};
+  bool dimerize{false};
+  std::optional<unsigned int> seed;
+  std::optional<bool> simd{std::nullopt};
 
   CLI::App app{"Implementation of the pivot algorithm"};
   argv = app.ensure_utf8(argv);
@@ -35,13 +43,22 @@ int main(int argc, char **argv) {
   app.add_option("-i,--iters", iters, "number of iterations")->required();
   app.add_flag("--naive", naive, "use naive implementation (slower)");
   app.add_flag("--fast,!--slow", fast_slow, "use fast implementation");
-  app.add_option("-w,--workers", num_workers, "number of workers");
+  app.add_option("-w,--workers", num_workers, "number of threads testing pivot proposals");
+  app.add_option("--leaf-size", leaf_size, "number of sites held by each leaf of the saw-tree")
+      ->check(CLI::Range(1, pivot::walk_node<1>::max_leaf_size));
+  app.add_option("--rebalance-slack", rebalance_slack,
+                 "number of levels the saw-tree may grow past balanced before it is rebalanced (0: after every pivot)")
+      ->check(CLI::NonNegativeNumber);
   app.add_flag("--success", require_success, "require success");
   app.add_flag("--verify", verify, "verify");
-  app.add_option("--in", in_path, "input path");
+  app.add_flag("--dimerize", dimerize, "start from a pseudo-dimerized walk rather than a straight line");
+  app.add_option("--in", in_path, "input path (CSV file or binary checkpoint, detected automatically)");
   app.add_option("--out", out_dir, "output directory");
-  app.add_option("--seed", seed, "seed")->default_val(std::random_device()());
-  app.add_flag("--simd", simd, "use SIMD (if supported)");
+  app.add_flag("--bin", save_bin, "save the walk and endpoints in binary (walk.bin, endpoints.bin) rather than CSV");
+  app.add_option("--sample-every", sample_every, "only save the endpoint of every k-th accepted walk")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--seed", seed, "seed (default: restored from a binary checkpoint, or random)");
+  app.add_flag("--simd,!--no-simd", simd, "use SIMD (default: if supported by the build and CPU)");
 
   CLI11_PARSE(app, argc, argv);
   bool fast;
@@ -51,7 +68,40 @@ int main(int argc, char **argv) {
     fast = !naive;
   }
 
-  if (!simd) {
+  if (num_workers < 0) {
+    std::cerr << "Invalid number of workers: " << num_workers << '\n';
+    return 1;
+  }
+  loop_options options{.naive = naive,
+                       .fast = fast,
+                       .seed = seed,
+                       .require_success = require_success,
+                       .verify = verify,
+                       .in_path = in_path,
+                       .out_dir = out_dir,
+                       .num_workers = num_workers,
+                       .leaf_size = leaf_size,
+                       .rebalance_slack = rebalance_slack,
+                       .save_bin = save_bin,
+                       .sample_every = sample_every,
+                       .dimerize = dimerize};
+
+  // pick the SIMD kernels whenever the CPU supports them, unless asked otherwise
+  bool use_simd = simd.value_or(pivot::simd_supported(dim));
+  if (use_simd && !pivot::simd_supported(dim)) {
+    if (!pivot::simd_built(dim)) {
+#ifdef ENABLE_AVX2
+      std::cerr << "SIMD only supported for dimensions 2 to " << SIMD_DIMS_UB - 1 << '\n';
+#else
+      std::cerr << "SIMD not enabled in this build\n";
+#endif
+    } else {
+      std::cerr << "SIMD in dimension " << dim << " not supported by this CPU\n";
+    }
+    return 1;
+  }
+
+  if (!use_simd) {
     switch (dim) {
       // cppcheck-suppress syntaxError
       BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, CASE_MACRO, ~)
@@ -61,14 +111,10 @@ int main(int argc, char **argv) {
     }
   } else {
 #ifdef ENABLE_AVX2
-    if (dim != 2) {
-      std::cerr << "SIMD only supported for 2D\n";
-      return 1;
+    switch (dim) {
+      BOOST_PP_REPEAT_FROM_TO(2, SIMD_DIMS_UB, SIMD_CASE_MACRO, ~)
     }
-    return main_loop<2, true>(num_steps, iters, naive, fast, seed, require_success, verify, in_path, out_dir);
-#else
-    std::cerr << "SIMD not enabled in this build\n";
-    return 1;
 #endif
+    return 1;
   }
 }
@@ -0,0 +1,19 @@
+#include "kernels.hpp"
+
+// dimension 2 is handled by explicit specializations
+#include "../lattice/box_simd_2d.hpp"
+#include "../lattice/point_simd_2d.hpp"
+#include "../lattice/transform_simd_2d.hpp"
+
+// SIMD Philox rounds, which the AVX-512 unit calls as well
+#include "../utils/philox_simd.hpp"
+
+namespace pivot {
+
+// cppcheck-suppress syntaxError
+BOOST_PP_REPEAT_FROM_TO(3, AVX2_DIMS_UB, LATTICE_SIMD_INST, ~)
+BOOST_PP_REPEAT_FROM_TO(2, AVX2_DIMS_UB, SIMD_INST, ~)
+
+} // namespace pivot
+
+BOOST_PP_REPEAT_FROM_TO(2, AVX2_DIMS_UB, MAIN_LOOP_SIMD_INST, ~)
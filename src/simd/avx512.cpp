@@ -0,0 +1,11 @@
+#include "kernels.hpp"
+
+namespace pivot {
+
+// cppcheck-suppress syntaxError
+BOOST_PP_REPEAT_FROM_TO(AVX2_DIMS_UB, SIMD_DIMS_UB, LATTICE_SIMD_INST, ~)
+BOOST_PP_REPEAT_FROM_TO(AVX2_DIMS_UB, SIMD_DIMS_UB, SIMD_INST, ~)
+
+} // namespace pivot
+
+BOOST_PP_REPEAT_FROM_TO(AVX2_DIMS_UB, SIMD_DIMS_UB, MAIN_LOOP_SIMD_INST, ~)
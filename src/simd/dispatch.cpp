@@ -0,0 +1,30 @@
+#include "defines.h"
+#include "dispatch.h"
+
+namespace pivot {
+
+bool simd_built([[maybe_unused]] int dim) {
+#ifdef ENABLE_AVX2
+  return dim >= 2 && dim < SIMD_DIMS_UB;
+#else
+  return false;
+#endif
+}
+
+bool simd_supported(int dim) {
+  if (!simd_built(dim)) {
+    return false;
+  }
+#ifdef ENABLE_AVX2
+  // queries cpuid (and whether the OS saves the extended registers)
+  __builtin_cpu_init();
+  if (dim < AVX2_DIMS_UB) {
+    return __builtin_cpu_supports("avx2");
+  }
+  return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl");
+#else
+  return false;
+#endif
+}
+
+} // namespace pivot
@@ -0,0 +1,57 @@
+#include <stdexcept>
+
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+
+#include "lattice_simd.h"
+
+#include "../lattice/box_simd.hpp"
+#include "../lattice/point.hpp"
+#include "../lattice/point_simd.hpp"
+#include "../lattice/transform.hpp"
+#include "../lattice/transform_simd.hpp"
+#include "../loop.h"
+#include "../utils/utils.hpp"
+#include "../walks/dimerize.hpp"
+#include "../walks/node/ctors.hpp"
+#include "../walks/node/graphviz.hpp"
+#include "../walks/node/pivot.hpp"
+#include "../walks/node/walk_node.hpp"
+#include "../walks/walk.hpp"
+#include "../walks/walk_tree.hpp"
+
+// Instantiations of everything that touches SIMD registers. Each instruction set has its own translation unit which
+// includes this file and is compiled with the corresponding flags, so that the rest of the library runs on any CPU.
+//
+// These units must not emit their own copies of functions that the baseline units emit too: the linker keeps a single
+// copy of each, and the baseline callers may end up with the one that was compiled with the flags. The scalar helpers
+// that the kernels call are thus declared extern in lattice_simd.h, the philox members are defined in philox.cpp, and
+// the helpers of lattice_simd.h live in a namespace per instruction set.
+
+namespace pivot {
+
+#define LATTICE_SIMD_INST(z, n, data)                                                                                  \
+  template struct box<n, true>;                                                                                        \
+  template class point<n, true>;                                                                                       \
+  template class transform<n, true>;
+
+#define SIMD_INST(z, n, data)                                                                                          \
+  template std::size_t point_hash::operator()<n>(const point<n, true> &p) const;                                       \
+  template std::vector<point<n, true>> from_csv<n, true>(const std::string &path);                                     \
+  template void to_csv<n, true>(const std::string &path, const std::vector<point<n, true>> &points);                   \
+  template checkpoint<n, true> from_bin<n, true>(const std::string &path);                                             \
+  template void to_bin<n, true>(const std::string &path, const std::vector<point<n, true>> &steps,                     \
+                                const std::string &rng_state);                                                         \
+  template checkpoint<n, true> from_file<n, true>(const std::string &path);                                            \
+  template std::vector<point<n, true>> line<n, true>(int num_steps);                                                   \
+  template std::vector<point<n, true>> pseudo_dimerize<n, true>(int num_sites, std::uint64_t seed, int num_workers);   \
+  template bool intersect<n, true>(const walk_node<n, true> *l_walk, const walk_node<n, true> *r_walk,                 \
+                                   const point<n, true> &l_anchor, const point<n, true> &r_anchor,                     \
+                                   const transform<n, true> &l_symm, const transform<n, true> &r_symm);                \
+  template class walk_node<n, true>;                                                                                   \
+  template class walk_tree<n, true>;                                                                                   \
+  template class walk<n, true>;
+
+} // namespace pivot
+
+#define MAIN_LOOP_SIMD_INST(z, n, data)                                                                                \
+  template int main_loop<n, true>(int num_steps, int iters, const loop_options &options);
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+
+#include "counters.h"
+
+namespace pivot {
+
+namespace {
+
+// Counters of the threads that are running, and the sum of those of the threads that have exited.
+std::mutex registry_mutex;
+std::unordered_set<counters *> registry;
+counters retired;
+
+// Registers the counters of a thread for as long as it runs.
+struct registered_counters {
+  counters c;
+
+  registered_counters() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.insert(&c);
+  }
+
+  ~registered_counters() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(&c);
+    retired += c;
+  }
+};
+
+} // namespace
+
+counters &counters::operator+=(const counters &c) {
+  intersect_calls += c.intersect_calls;
+  nodes_visited += c.nodes_visited;
+  box_tests += c.box_tests;
+  leaf_tests += c.leaf_tests;
+  max_depth = std::max(max_depth, c.max_depth);
+  shuffle_tests += c.shuffle_tests;
+  merges += c.merges;
+  rotations += c.rotations;
+  commits += c.commits;
+  for (int i = 0; i <= max_level; ++i) {
+    collision_levels[i] += c.collision_levels[i];
+  }
+  return *this;
+}
+
+std::string counters::to_json() const {
+  std::ostringstream out;
+  out << "{\"intersect_calls\": " << intersect_calls << ", \"nodes_visited\": " << nodes_visited
+      << ", \"box_tests\": " << box_tests << ", \"leaf_tests\": " << leaf_tests << ", \"max_depth\": " << max_depth
+      << ", \"shuffle_tests\": " << shuffle_tests << ", \"merges\": " << merges << ", \"rotations\": " << rotations
+      << ", \"commits\": " << commits << ", \"rotations_per_commit\": "
+      << (commits > 0 ? static_cast<double>(rotations) / static_cast<double>(commits) : 0.0)
+      << ", \"collision_levels\": [";
+  // trailing levels without collisions are left out
+  int num_levels = max_level + 1;
+  while (num_levels > 0 && collision_levels[num_levels - 1] == 0) {
+    --num_levels;
+  }
+  for (int i = 0; i < num_levels; ++i) {
+    out << (i > 0 ? ", " : "") << collision_levels[i];
+  }
+  out << "]}";
+  return out.str();
+}
+
+counters &thread_counters() {
+  thread_local registered_counters c;
+  return c.c;
+}
+
+counters collect_counters() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto total = retired;
+  retired = counters();
+  for (auto c : registry) {
+    total += *c;
+    *c = counters();
+  }
+  return total;
+}
+
+} // namespace pivot
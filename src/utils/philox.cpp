@@ -0,0 +1,48 @@
+#include "philox.h"
+
+namespace pivot {
+
+// Defined here rather than in the header so that the SIMD units, which are compiled with other instruction set flags,
+// call the baseline copies instead of emitting their own.
+
+philox::result_type philox::operator()() {
+  if (next_ == 2) {
+    auto x = block(ctr_, key_);
+    out_ = {static_cast<std::uint64_t>(x[1]) << 32 | x[0], static_cast<std::uint64_t>(x[3]) << 32 | x[2]};
+    next_ = 0;
+    if (++ctr_[0] == 0) {
+      ++ctr_[1];
+    }
+  }
+  return out_[next_++];
+}
+
+void philox::first_blocks(std::uint64_t seed, std::uint64_t first, std::span<std::array<result_type, 2>> blocks) {
+  constexpr std::size_t lanes = 8;
+  for (std::size_t i = 0; i < blocks.size(); i += lanes) {
+    // lane l holds the counter of the first block of stream first + i + l, i.e. (0, 0, first + i + l)
+    std::array<std::uint32_t, lanes> x0{}, x1{}, x2, x3;
+    for (std::size_t l = 0; l < lanes; ++l) {
+      x2[l] = static_cast<std::uint32_t>(first + i + l);
+      x3[l] = static_cast<std::uint32_t>((first + i + l) >> 32);
+    }
+    std::array<std::uint32_t, 2> key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+    for (int round = 0; round < 10; ++round) {
+      for (std::size_t l = 0; l < lanes; ++l) {
+        auto p0 = m0 * x0[l];
+        auto p1 = m1 * x2[l];
+        x0[l] = static_cast<std::uint32_t>(p1 >> 32) ^ x1[l] ^ key[0];
+        x1[l] = static_cast<std::uint32_t>(p1);
+        x2[l] = static_cast<std::uint32_t>(p0 >> 32) ^ x3[l] ^ key[1];
+        x3[l] = static_cast<std::uint32_t>(p0);
+      }
+      key[0] += w0;
+      key[1] += w1;
+    }
+    for (std::size_t l = 0; l < lanes && i + l < blocks.size(); ++l) {
+      blocks[i + l] = {static_cast<result_type>(x1[l]) << 32 | x0[l], static_cast<result_type>(x3[l]) << 32 | x2[l]};
+    }
+  }
+}
+
+} // namespace pivot
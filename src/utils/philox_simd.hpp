@@ -0,0 +1,69 @@
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "lattice_simd.h"
+#include "philox.h"
+
+// Included by the AVX2 unit only (see philox.h); the helper still gets the namespace of its instruction set, like those
+// of lattice_simd.h.
+inline namespace avx2 {
+
+// Sets lo and hi to the low and high halves of the 64-bit products of the 32-bit lanes of x by m.
+inline void mulhilo_epu32(__m256i x, __m256i m, __m256i &lo, __m256i &hi) {
+  auto even = _mm256_mul_epu32(x, m);
+  auto odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+  lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0b10101010);
+  hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0b10101010);
+}
+
+} // namespace avx2
+
+namespace pivot {
+
+template <>
+void philox_first_blocks<true>(std::uint64_t seed, std::uint64_t first,
+                               std::span<std::array<philox::result_type, 2>> blocks) {
+  constexpr std::size_t lanes = 8;
+  const auto m0 = _mm256_set1_epi64x(philox::m0);
+  const auto m1 = _mm256_set1_epi64x(philox::m1);
+  std::size_t i = 0;
+  for (; i + lanes <= blocks.size(); i += lanes) {
+    // lane l holds the counter of the first block of stream first + i + l, i.e. (0, 0, first + i + l)
+    std::array<std::uint32_t, lanes> lo, hi;
+    for (std::size_t l = 0; l < lanes; ++l) {
+      lo[l] = static_cast<std::uint32_t>(first + i + l);
+      hi[l] = static_cast<std::uint32_t>((first + i + l) >> 32);
+    }
+    auto x0 = _mm256_setzero_si256();
+    auto x1 = _mm256_setzero_si256();
+    auto x2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lo.data()));
+    auto x3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hi.data()));
+    auto k0 = static_cast<std::uint32_t>(seed);
+    auto k1 = static_cast<std::uint32_t>(seed >> 32);
+    for (int round = 0; round < 10; ++round) {
+      __m256i lo0, hi0, lo1, hi1;
+      mulhilo_epu32(x0, m0, lo0, hi0);
+      mulhilo_epu32(x2, m1, lo1, hi1);
+      x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), _mm256_set1_epi32(static_cast<int>(k0)));
+      x1 = lo1;
+      x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), _mm256_set1_epi32(static_cast<int>(k1)));
+      x3 = lo0;
+      k0 += philox::w0;
+      k1 += philox::w1;
+    }
+    // interleave the 32-bit words of each stream into its pair of 64-bit outputs
+    std::array<std::uint32_t, lanes> w0, w1, w2, w3;
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(w0.data()), x0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(w1.data()), x1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(w2.data()), x2);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(w3.data()), x3);
+    for (std::size_t l = 0; l < lanes; ++l) {
+      blocks[i + l] = {static_cast<philox::result_type>(w1[l]) << 32 | w0[l],
+                       static_cast<philox::result_type>(w3[l]) << 32 | w2[l]};
+    }
+  }
+  philox::first_blocks(seed, first + i, blocks.subspan(i));
+}
+
+} // namespace pivot
@@ -0,0 +1,118 @@
+#include <charconv>
+#include <stdexcept>
+
+#include "sample_sink.h"
+
+namespace pivot {
+
+sample_writer::sample_writer(const std::string &path, int width, bool binary, int every, std::size_t buffer_rows)
+    : width_(width), binary_(binary), every_(every), buffer_rows_(buffer_rows) {
+  if (width < 1 || every < 1 || buffer_rows < 1) {
+    throw std::invalid_argument("width, decimation and buffer size must be positive");
+  }
+  file_.open(path, binary ? std::ios::binary : std::ios::out);
+  if (!file_) {
+    throw std::runtime_error("Could not open file: " + path);
+  }
+  buffer_.reserve(buffer_rows_ * width_);
+  thread_ = std::thread(&sample_writer::work, this);
+}
+
+sample_writer::~sample_writer() {
+  try {
+    close();
+  } catch (const std::exception &) {
+  }
+}
+
+void sample_writer::push(const int *row) {
+  if (count_++ % every_ != 0) {
+    return;
+  }
+  buffer_.insert(buffer_.end(), row, row + width_);
+  if (buffer_.size() == buffer_rows_ * width_) {
+    hand_over();
+  }
+}
+
+void sample_writer::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  if (!buffer_.empty()) {
+    hand_over();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  ready_.notify_one();
+  thread_.join();
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void sample_writer::hand_over() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    written_.wait(lock, [this] { return pending_.size() < max_pending || error_; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    pending_.push_back(std::move(buffer_));
+  }
+  ready_.notify_one();
+  buffer_ = std::vector<int>();
+  buffer_.reserve(buffer_rows_ * width_);
+}
+
+void sample_writer::write(const std::vector<int> &rows) {
+  if (binary_) {
+    file_.write(reinterpret_cast<const char *>(rows.data()), rows.size() * sizeof(int));
+  } else {
+    // at most 11 characters per integer, plus a separator
+    std::string text(rows.size() * 12, '\0');
+    char *out = text.data();
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+      out = std::to_chars(out, text.data() + text.size(), rows[i]).ptr;
+      *out++ = (i + 1) % width_ == 0 ? '\n' : ',';
+    }
+    file_.write(text.data(), out - text.data());
+  }
+  file_.flush();
+  if (!file_) {
+    throw std::runtime_error("Could not write samples");
+  }
+}
+
+void sample_writer::work() {
+  while (true) {
+    std::vector<int> rows;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return !pending_.empty() || stop_; });
+      if (pending_.empty()) {
+        return;
+      }
+      rows = std::move(pending_.front());
+    }
+    try {
+      write(rows);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.pop_front();
+    }
+    written_.notify_one();
+    if (error_) {
+      return;
+    }
+  }
+}
+
+} // namespace pivot
@@ -1,71 +1,66 @@
-#include <fstream>
-#include <stdexcept>
-#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <boost/preprocessor/repetition/repeat_from_to.hpp>
 
-#include "utils.h"
-
-#ifdef ENABLE_AVX2
-#include "lattice_simd.h"
-#endif
+#include "utils.hpp"
 
 namespace pivot {
 
-template <int Dim, bool Simd = false> std::vector<point<Dim, Simd>> from_csv(const std::string &path) {
-  std::ifstream file(path);
-  std::vector<point<Dim, Simd>> points;
-  std::string line;
-  while (std::getline(file, line)) {
-    std::array<int, Dim> coords;
-    size_t start = 0;
-    for (int i = 0; i < Dim; ++i) {
-      size_t end = line.find(',', start);
-      if (end == std::string::npos && i < Dim - 1) {
-        throw std::invalid_argument("Invalid CSV format at line " + std::to_string(points.size()));
-      }
-      coords[i] = std::stoi(line.substr(start, end - start));
-      start = end + 1;
-    }
-    points.push_back(point<Dim, Simd>(coords));
-  }
-  return points;
+bool is_bin(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::array<char, 8> magic{};
+  file.read(magic.data(), magic.size());
+  return file && magic == bin_header::magic_value;
 }
 
-template <int Dim, bool Simd = false>
-void to_csv(const std::string &path, const std::vector<point<Dim, Simd>> &points) {
-  // TODO: check path exists
-  std::ofstream file(path);
-  for (const auto &p : points) {
-    for (int i = 0; i < Dim - 1; ++i) {
-      file << p[i] << ",";
+mapped_file::mapped_file(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open file: " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Could not stat file: " + path);
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Could not map file: " + path);
     }
-    file << p[Dim - 1] << std::endl;
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const unsigned char *>(data);
   }
+  close(fd);
 }
 
-template <int Dim, bool Simd = false> std::vector<point<Dim, Simd>> line(int num_steps) {
-  std::vector<point<Dim, Simd>> steps(num_steps);
-  for (int i = 0; i < num_steps; ++i) {
-    steps[i] = (i + 1) * point<Dim, Simd>::unit(0);
+mapped_file::~mapped_file() {
+  if (data_ != nullptr) {
+    munmap(const_cast<unsigned char *>(data_), size_);
   }
-  return steps;
 }
 
 #define FROM_CSV_INST(z, n, data) template std::vector<point<n>> from_csv<n, false>(const std::string &path);
 #define TO_CSV_INST(z, n, data)                                                                                        \
   template void to_csv<n, false>(const std::string &path, const std::vector<point<n>> &points);
+#define FROM_BIN_INST(z, n, data) template checkpoint<n, false> from_bin<n, false>(const std::string &path);
+#define TO_BIN_INST(z, n, data)                                                                                        \
+  template void to_bin<n, false>(const std::string &path, const std::vector<point<n>> &steps,                          \
+                                 const std::string &rng_state);
+#define FROM_FILE_INST(z, n, data) template checkpoint<n, false> from_file<n, false>(const std::string &path);
 #define LINE_INST(z, n, data) template std::vector<point<n>> line<n, false>(int num_steps);
 
 // cppcheck-suppress syntaxError
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, TO_CSV_INST, ~)
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, FROM_CSV_INST, ~)
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, FROM_BIN_INST, ~)
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, TO_BIN_INST, ~)
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, FROM_FILE_INST, ~)
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, LINE_INST, ~)
 
-#ifdef ENABLE_AVX2
-template std::vector<point<2, true>> from_csv<2, true>(const std::string &path);
-template void to_csv<2, true>(const std::string &path, const std::vector<point<2, true>> &points);
-template std::vector<point<2, true>> line<2, true>(int num_steps);
-#endif
-
 } // namespace pivot
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "utils.h"
+
+namespace pivot {
+
+/** @brief Fixed-size header of a binary checkpoint (see to_bin). */
+struct bin_header {
+  static constexpr std::array<char, 8> magic_value{'P', 'I', 'V', 'O', 'T', 'B', 'I', 'N'};
+  // version 1 saved the state of a std::mt19937 engine, which walks no longer use, and is rejected
+  static constexpr std::uint32_t current_version = 2;
+
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t dim;
+  std::uint64_t num_sites;
+  std::uint64_t rng_state_size;
+};
+
+/** @brief Read-only memory mapping of an entire file. */
+class mapped_file {
+public:
+  explicit mapped_file(const std::string &path);
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  ~mapped_file();
+
+  const unsigned char *data() const { return data_; }
+
+  std::size_t size() const { return size_; }
+
+private:
+  const unsigned char *data_{};
+  std::size_t size_{};
+};
+
+template <int Dim, bool Simd = false> std::vector<point<Dim, Simd>> from_csv(const std::string &path) {
+  std::ifstream file(path);
+  std::vector<point<Dim, Simd>> points;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::array<int, Dim> coords;
+    const char *it = line.data();
+    const char *end = line.data() + line.size();
+    for (int i = 0; i < Dim; ++i) {
+      auto [ptr, ec] = std::from_chars(it, end, coords[i]);
+      if (ec != std::errc() || (i < Dim - 1 && (ptr == end || *ptr != ','))) {
+        throw std::invalid_argument("Invalid CSV format at line " + std::to_string(points.size()));
+      }
+      it = ptr + 1;
+    }
+    points.push_back(point<Dim, Simd>(coords));
+  }
+  return points;
+}
+
+template <int Dim, bool Simd = false>
+void to_csv(const std::string &path, const std::vector<point<Dim, Simd>> &points) {
+  // TODO: check path exists
+  std::ofstream file(path);
+  for (const auto &p : points) {
+    for (int i = 0; i < Dim - 1; ++i) {
+      file << p[i] << ",";
+    }
+    file << p[Dim - 1] << '\n';
+  }
+}
+
+template <int Dim, bool Simd> checkpoint<Dim, Simd> from_bin(const std::string &path) {
+  mapped_file file(path);
+  bin_header header;
+  if (file.size() < sizeof(header)) {
+    throw std::runtime_error("Not a binary checkpoint: " + path);
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.magic != bin_header::magic_value) {
+    throw std::runtime_error("Not a binary checkpoint: " + path);
+  }
+  if (header.version != bin_header::current_version) {
+    throw std::runtime_error("Unsupported checkpoint version " + std::to_string(header.version) + ": " + path);
+  }
+  if (header.dim != Dim) {
+    throw std::runtime_error("Checkpoint has dimension " + std::to_string(header.dim) + ", expected " +
+                             std::to_string(Dim) + ": " + path);
+  }
+  auto first_offset = sizeof(header) + header.rng_state_size;
+  if (header.num_sites == 0 || header.rng_state_size > file.size() || header.num_sites > file.size() ||
+      file.size() != first_offset + Dim * sizeof(std::int32_t) + header.num_sites - 1) {
+    throw std::runtime_error("Truncated or corrupted checkpoint: " + path);
+  }
+
+  checkpoint<Dim, Simd> result;
+  result.rng_state.assign(reinterpret_cast<const char *>(file.data() + sizeof(header)), header.rng_state_size);
+
+  std::array<std::int32_t, Dim> first;
+  std::memcpy(first.data(), file.data() + first_offset, sizeof(first));
+  std::array<int, Dim> coords;
+  std::copy(first.begin(), first.end(), coords.begin());
+
+  // step codes 2i and 2i + 1 are the unit moves +e_i and -e_i
+  std::array<point<Dim, Simd>, 2 * Dim> moves;
+  for (int i = 0; i < Dim; ++i) {
+    moves[2 * i] = point<Dim, Simd>::unit(i);
+    moves[2 * i + 1] = -1 * point<Dim, Simd>::unit(i);
+  }
+  const unsigned char *codes = file.data() + first_offset + sizeof(first);
+  auto &steps = result.steps;
+  steps.resize(header.num_sites);
+  steps[0] = point<Dim, Simd>(coords);
+  for (std::uint64_t i = 1; i < header.num_sites; ++i) {
+    auto code = codes[i - 1];
+    if (code >= 2 * Dim) {
+      throw std::runtime_error("Invalid step at site " + std::to_string(i) + " of checkpoint: " + path);
+    }
+    steps[i] = steps[i - 1] + moves[code];
+  }
+  return result;
+}
+
+template <int Dim, bool Simd>
+void to_bin(const std::string &path, const std::vector<point<Dim, Simd>> &steps, const std::string &rng_state) {
+  if (steps.empty()) {
+    throw std::invalid_argument("cannot save an empty walk");
+  }
+  std::vector<unsigned char> codes(steps.size() - 1);
+  for (std::size_t i = 1; i < steps.size(); ++i) {
+    auto delta = steps[i] - steps[i - 1];
+    int axis = -1;
+    bool neighbours = true;
+    for (int j = 0; j < Dim; ++j) {
+      if (delta[j] != 0) {
+        neighbours = neighbours && axis < 0 && std::abs(delta[j]) == 1;
+        axis = j;
+      }
+    }
+    if (!neighbours || axis < 0) {
+      throw std::invalid_argument("sites " + std::to_string(i - 1) + " and " + std::to_string(i) +
+                                  " are not neighbours");
+    }
+    codes[i - 1] = 2 * axis + (delta[axis] < 0);
+  }
+
+  bin_header header{bin_header::magic_value, bin_header::current_version, Dim, steps.size(), rng_state.size()};
+  std::array<std::int32_t, Dim> first;
+  for (int i = 0; i < Dim; ++i) {
+    first[i] = steps[0][i];
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(rng_state.data(), rng_state.size());
+  file.write(reinterpret_cast<const char *>(first.data()), sizeof(first));
+  file.write(reinterpret_cast<const char *>(codes.data()), codes.size());
+  if (!file) {
+    throw std::runtime_error("Could not write checkpoint: " + path);
+  }
+}
+
+template <int Dim, bool Simd> checkpoint<Dim, Simd> from_file(const std::string &path) {
+  if (is_bin(path)) {
+    return from_bin<Dim, Simd>(path);
+  }
+  return {from_csv<Dim, Simd>(path), ""};
+}
+
+template <int Dim, bool Simd = false> std::vector<point<Dim, Simd>> line(int num_steps) {
+  std::vector<point<Dim, Simd>> steps(num_steps);
+  for (int i = 0; i < num_steps; ++i) {
+    steps[i] = (i + 1) * point<Dim, Simd>::unit(0);
+  }
+  return steps;
+}
+
+} // namespace pivot
@@ -0,0 +1,66 @@
+#include <stdexcept>
+
+#include "worker_pool.h"
+
+namespace pivot {
+
+worker_pool::worker_pool(int num_workers) : num_workers_(num_workers) {
+  if (num_workers < 1) {
+    throw std::invalid_argument("number of workers must be positive");
+  }
+  threads_.reserve(num_workers - 1);
+  for (int i = 1; i < num_workers; ++i) {
+    threads_.emplace_back(&worker_pool::work, this, i);
+  }
+}
+
+worker_pool::~worker_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void worker_pool::run(const std::function<void(int)> &task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    running_ = num_workers_ - 1;
+    ++generation_;
+  }
+  start_.notify_all();
+  task(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return running_ == 0; });
+  task_ = nullptr;
+}
+
+void worker_pool::work(int id) {
+  unsigned long seen = 0;
+  while (true) {
+    const std::function<void(int)> *task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      task = task_;
+    }
+
+    (*task)(id);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--running_ == 0) {
+      done_.notify_one();
+    }
+  }
+}
+
+} // namespace pivot
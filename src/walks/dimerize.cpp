@@ -0,0 +1,15 @@
+#include <boost/preprocessor/repetition/repeat_from_to.hpp>
+
+#include "dimerize.hpp"
+
+namespace pivot {
+
+/* TEMPLATE INSTANTIATION */
+
+#define DIMERIZE_INST(z, n, data)                                                                                      \
+  template std::vector<point<n>> pseudo_dimerize<n, false>(int num_sites, std::uint64_t seed, int num_workers);
+
+// cppcheck-suppress syntaxError
+BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, DIMERIZE_INST, ~)
+
+} // namespace pivot
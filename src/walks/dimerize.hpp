@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "dimerize.h"
+#include "occupancy.h"
+#include "philox.h"
+
+namespace pivot {
+
+namespace {
+
+// Walks of at most this many sites are grown directly rather than made of two halves.
+constexpr int max_grown_sites = 16;
+
+// Walks shorter than this are built by a single thread, whatever the number of workers.
+constexpr int min_threaded_sites = 1 << 17;
+
+// Largest number of sites next to the joint that the pivots repairing a failed join may move.
+constexpr int repair_window = 64;
+
+// Streams of the seed from this one on are drawn from by pseudo_dimerize, while pivot proposals count from 0.
+constexpr std::uint64_t first_stream = std::uint64_t{1} << 63;
+
+// Returns a uniformly random self-avoiding walk on n sites, starting at unit(0), as the first of a sequence of
+// non-reversing random walks which does not hit itself.
+template <int Dim, bool Simd> std::vector<point<Dim, Simd>> grow(int n, philox &gen) {
+  std::vector<point<Dim, Simd>> sites(n);
+  sites[0] = point<Dim, Simd>::unit(0);
+  std::uniform_int_distribution<int> first_dir(0, 2 * Dim - 1);
+  std::uniform_int_distribution<int> next_dir(0, 2 * Dim - 2);
+  int dir = 0; // directions 2k and 2k + 1 are the positive and negative unit vectors of axis k
+  for (int i = 1; i < n;) {
+    if (i == 1) {
+      dir = first_dir(gen);
+    } else {
+      // skip the direction going back to the previous site
+      auto d = next_dir(gen);
+      dir = d >= (dir ^ 1) ? d + 1 : d;
+    }
+    auto p = dir % 2 == 0 ? sites[i - 1] + point<Dim, Simd>::unit(dir / 2)
+                          : sites[i - 1] - point<Dim, Simd>::unit(dir / 2);
+    // site i - 2 cannot be hit by a non-reversing walk
+    if (std::find(sites.begin(), sites.begin() + std::max(i - 2, 0), p) != sites.begin() + std::max(i - 2, 0)) {
+      i = 1;
+      continue;
+    }
+    sites[i++] = p;
+  }
+  return sites;
+}
+
+// Pivots by t the sites with indices in [first, last) about site c next to them (first - 1 or last) if this leaves the
+// walk self-avoiding, keeping its occupancy up to date. The sites are tested from the nearest to c, which are the
+// likeliest to collide, and only the moved sites are visited.
+template <int Dim, bool Simd>
+bool try_pivot_range(std::vector<point<Dim, Simd>> &sites, hash_occupancy<Dim, Simd> &occupied, int first, int last,
+                     int c, const transform<Dim, Simd> &t, std::vector<point<Dim, Simd>> &moved) {
+  moved.resize(last - first);
+  for (int k = 0; k < last - first; ++k) {
+    int i = c < first ? first + k : last - 1 - k;
+    auto p = sites[c] + t * (sites[i] - sites[c]);
+    int j = occupied.find(p);
+    if (j >= 0 && (j < first || j >= last)) {
+      return false;
+    }
+    moved[i - first] = p;
+  }
+  for (int i = first; i < last; ++i) {
+    occupied.erase(sites[i]);
+  }
+  for (int i = first; i < last; ++i) {
+    sites[i] = moved[i - first];
+    occupied.insert(sites[i], i);
+  }
+  return true;
+}
+
+// Appends the sites of right to those of left, joined by a uniformly random symmetry t, i.e. so that site i of right
+// lands on left.back() + t * (right[i] - right[0] + unit(0)). After each join which is not self-avoiding, either half
+// is pivoted about a random site near the joint before the next try.
+template <int Dim, bool Simd>
+void join(std::vector<point<Dim, Simd>> &left, std::vector<point<Dim, Simd>> right, philox &gen) {
+  int n1 = left.size();
+  int n2 = right.size();
+  hash_occupancy<Dim, Simd> left_occupied(left);
+  std::optional<hash_occupancy<Dim, Simd>> right_occupied; // only built if a join fails
+  std::vector<point<Dim, Simd>> moved;
+  std::uniform_int_distribution<int> left_site(1, std::min(n1 - 1, repair_window));
+  std::uniform_int_distribution<int> right_site(1, std::min(n2 - 1, repair_window));
+  while (true) {
+    auto t = transform<Dim, Simd>::rand(gen);
+    auto joint = left.back() + t * point<Dim, Simd>::unit(0);
+    auto origin = right[0];
+    // sites of right near the joint are tested first, as they are the likeliest to collide
+    bool self_avoiding = true;
+    for (int i = 0; i < n2 && self_avoiding; ++i) {
+      self_avoiding = left_occupied.find(joint + t * (right[i] - origin)) < 0;
+    }
+    if (self_avoiding) {
+      left.resize(n1 + n2);
+      for (int i = 0; i < n2; ++i) {
+        left[n1 + i] = joint + t * (right[i] - origin);
+      }
+      return;
+    }
+
+    // Trying other symmetries on the same halves would favour those which fail most joins, which tend to be compact, so
+    // either half is first changed by a successful pivot (the identity always is one).
+    if (!right_occupied.has_value()) {
+      right_occupied.emplace(right);
+    }
+    bool on_left = gen() % 2 == 0;
+    for (bool repaired = false; !repaired;) {
+      auto r = transform<Dim, Simd>::rand(gen);
+      int k = on_left ? left_site(gen) : right_site(gen);
+      repaired = on_left ? try_pivot_range(left, left_occupied, n1 - k, n1, n1 - k - 1, r, moved)
+                         : try_pivot_range(right, *right_occupied, 0, k, k, r, moved);
+    }
+  }
+}
+
+// Builds a walk on n sites from the given stream of the seed, splitting the given number of threads between its halves.
+template <int Dim, bool Simd>
+std::vector<point<Dim, Simd>> build(int n, std::uint64_t seed, std::uint64_t stream, int num_threads) {
+  philox gen(seed, stream);
+  if (n <= max_grown_sites) {
+    return grow<Dim, Simd>(n, gen);
+  }
+  // the streams of the halves are drawn before anything else, so they do not depend on how the halves are built
+  auto left_stream = first_stream | gen();
+  auto right_stream = first_stream | gen();
+  int n1 = n / 2;
+  std::vector<point<Dim, Simd>> left, right;
+  if (num_threads > 1 && n >= min_threaded_sites) {
+    std::thread left_thread([&] { left = build<Dim, Simd>(n1, seed, left_stream, num_threads / 2); });
+    right = build<Dim, Simd>(n - n1, seed, right_stream, num_threads - num_threads / 2);
+    left_thread.join();
+  } else {
+    left = build<Dim, Simd>(n1, seed, left_stream, 1);
+    right = build<Dim, Simd>(n - n1, seed, right_stream, 1);
+  }
+  join(left, std::move(right), gen);
+  return left;
+}
+
+} // namespace
+
+template <int Dim, bool Simd>
+std::vector<point<Dim, Simd>> pseudo_dimerize(int num_sites, std::uint64_t seed, int num_workers) {
+  if (num_sites < 2) {
+    throw std::invalid_argument("walk must have at least 2 sites (1 step)");
+  }
+  if (num_workers < 1) {
+    throw std::invalid_argument("number of workers must be positive");
+  }
+  return build<Dim, Simd>(num_sites, seed, first_stream, num_workers);
+}
+
+} // namespace pivot
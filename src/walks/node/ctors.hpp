@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "walk_node.h"
 
 namespace pivot {
@@ -13,68 +15,102 @@ walk_node<Dim, Simd> *walk_node<Dim, Simd>::pivot_rep(const std::vector<point<Di
   if (num_sites < 2) {
     throw std::invalid_argument("num_sites must be at least 2");
   }
+  auto leaf = new (buf) walk_node(create_leaf());
+  leaf->update_moments();
   walk_node<Dim, Simd> *root =
-      buf ? new (buf)
-                walk_node(1, num_sites, transform(steps[0], steps[1]), box<Dim, Simd>(steps), steps[num_sites - 1])
-          : new walk_node(1, num_sites, transform(steps[0], steps[1]), box<Dim, Simd>(steps), steps[num_sites - 1]);
+      new (buf + 1) walk_node(1, num_sites, transform(steps[0], steps[1]), box<Dim, Simd>(steps), steps[num_sites - 1]);
+  root->set_left(leaf);
+  root->height_ = std::min(num_sites - 1, max_stored_height);
   auto node = root;
   for (int i = 0; i < num_sites - 2; ++i) {
     auto id = i + 2;
-    node->right_ = buf ? new (buf + id - 1) walk_node(id, num_sites - i - 1, transform(steps[i + 1], steps[i + 2]),
-                                                      box(std::span<const point<Dim, Simd>>(steps).subspan(i + 1)),
-                                                      steps[num_sites - 1])
-                       : new walk_node(i + 2, num_sites - i - 1, transform(steps[i + 1], steps[i + 2]),
-                                       box(std::span<const point<Dim, Simd>>(steps).subspan(i + 1)),
-                                       steps[num_sites - 1]); // TODO: double-check this
-    node->right_->parent_ = node;
-    node = node->right_;
+    auto right = new (buf + id) walk_node(id, num_sites - i - 1, transform(steps[i + 1], steps[i + 2]),
+                                          box(std::span<const point<Dim, Simd>>(steps).subspan(i + 1)),
+                                          steps[num_sites - 1]); // TODO: double-check this
+    right->set_left(leaf);
+    right->height_ = std::min(num_sites - id, max_stored_height);
+    node->set_right(right);
+    node = right;
+  }
+  node->set_right(leaf);
+  for (int id = num_sites - 1; id > 0; --id) {
+    buf[id].update_moments();
   }
   return root;
 }
 
 template <int Dim, bool Simd>
 walk_node<Dim, Simd> *walk_node<Dim, Simd>::balanced_rep(const std::vector<point<Dim, Simd>> &steps,
-                                                         walk_node<Dim, Simd> *buf) {
-  return balanced_rep(steps, 1, transform<Dim, Simd>(), buf);
+                                                         walk_node<Dim, Simd> *buf, int leaf_size) {
+  if (leaf_size < 1 || leaf_size > max_leaf_size) {
+    throw std::invalid_argument("leaf_size must be between 1 and " + std::to_string(max_leaf_size));
+  }
+  int num_sites = steps.size();
+  if (leaf_size > 1 && num_sites <= leaf_size) {
+    throw std::invalid_argument("num_sites must be greater than leaf_size");
+  }
+  new (buf) walk_node(create_leaf());
+  buf->update_moments();
+  int num_blocks = (num_sites + leaf_size - 1) / leaf_size;
+  return balanced_rep(steps, 1, transform<Dim, Simd>(), buf, leaf_size, buf + num_blocks);
 }
 
 template <int Dim, bool Simd>
 walk_node<Dim, Simd> *walk_node<Dim, Simd>::balanced_rep(std::span<const point<Dim, Simd>> steps, int start,
                                                          const transform<Dim, Simd> &glob_symm,
-                                                         walk_node<Dim, Simd> *buf) {
+                                                         walk_node<Dim, Simd> *buf, int leaf_size,
+                                                         walk_node<Dim, Simd> *leaves) {
   int num_sites = steps.size();
   if (num_sites < 1) {
     throw std::invalid_argument("num_sites must be at least 1");
   }
-  if (num_sites == 1) {
-    return &leaf();
+  if (num_sites == 1 && leaf_size == 1) {
+    return buf;
   }
 
   /* The steps span gives an "absolute" view of the walk, but a "relative" view is required, since each sub-tree,
   including the current one, must itself be a walk anchored at the first coordinate vector. The "global symmetry"
   glob_symm represents the transformation "accumulated" since the root of the tree under construction. Its effect
   must be reversed in order to obtain the relative properties of the current node. */
-  int n = std::floor((1 + num_sites) / 2.0);
-  auto abs_symm = transform(steps[n - 1], steps[n]);
   auto glob_inv = glob_symm.inverse();
+  if (num_sites <= leaf_size) {
+    std::array<point<Dim, Simd>, max_leaf_size> sites;
+    for (int i = 0; i < num_sites; ++i) {
+      sites[i] = glob_inv * (steps[i] - steps.front()) + point<Dim, Simd>::unit(0);
+    }
+    int block = (start - 1) / leaf_size;
+    return create_leaf(start - 1, std::span(sites.data(), num_sites), leaves + block * leaf_slots(leaf_size));
+  }
+
+  // sites are split between leaves, so nodes only split the walk between blocks of leaf_size sites
+  int num_blocks = (num_sites + leaf_size - 1) / leaf_size;
+  int n = leaf_size * ((1 + num_blocks) / 2);
+  auto abs_symm = transform(steps[n - 1], steps[n]);
   auto rel_symm = glob_inv * abs_symm;
   auto rel_end = glob_inv * (steps.back() - steps.front()) + point<Dim, Simd>::unit(0);
   auto rel_box = point<Dim, Simd>::unit(0) + glob_inv * (box(steps) - point<Dim, Simd>::unit(0));
   int id = start + n - 1;
-  walk_node *root = buf ? new (buf + id - 1) walk_node(id, num_sites, rel_symm, rel_box, rel_end)
-                        : new walk_node(id, num_sites, rel_symm, rel_box, rel_end);
+  walk_node *root = new (buf + id / leaf_size) walk_node(id, num_sites, rel_symm, rel_box, rel_end);
 
-  if (n >= 1) {
-    root->left_ = balanced_rep(steps.subspan(0, n), start, glob_symm, buf);
-    root->left_->parent_ = root;
-  }
-  if (num_sites - n >= 1) {
-    root->right_ = balanced_rep(steps.subspan(n), start + n, glob_symm * rel_symm, buf);
-    root->right_->parent_ = root;
-  }
+  root->set_left(balanced_rep(steps.subspan(0, n), start, glob_symm, buf, leaf_size, leaves));
+  root->set_right(balanced_rep(steps.subspan(n), start + n, glob_symm * rel_symm, buf, leaf_size, leaves));
+  root->update_height();
+  root->update_moments();
   return root;
 }
 
+template <int Dim, bool Simd> int walk_node<Dim, Simd>::leaf_slots(int num_sites) {
+  return 1 + (num_sites * Dim + sizeof(walk_node) - 1) / sizeof(walk_node);
+}
+
+template <int Dim, bool Simd> std::size_t walk_node<Dim, Simd>::num_slots(int num_sites, int leaf_size) {
+  if (leaf_size == 1) {
+    return num_sites;
+  }
+  std::size_t num_blocks = (num_sites + leaf_size - 1) / leaf_size;
+  return num_blocks * (1 + leaf_slots(leaf_size));
+}
+
 template <int Dim, bool Simd> walk_node<Dim, Simd> walk_node<Dim, Simd>::create_leaf() {
   std::array<interval, Dim> intervals;
   intervals[0] = interval(1, 1);
@@ -84,8 +120,12 @@ template <int Dim, bool Simd> walk_node<Dim, Simd> walk_node<Dim, Simd>::create_
   return walk_node(0, 1, transform<Dim, Simd>(), box<Dim, Simd>(intervals), point<Dim, Simd>::unit(0));
 }
 
-template <int Dim, bool Simd> walk_node<Dim, Simd> &walk_node<Dim, Simd>::leaf() {
-  static walk_node<Dim, Simd> leaf = create_leaf();
+template <int Dim, bool Simd>
+walk_node<Dim, Simd> *walk_node<Dim, Simd>::create_leaf(int id, std::span<const point<Dim, Simd>> sites,
+                                                        walk_node *dest) {
+  auto leaf = new (dest) walk_node(id, sites.size(), transform<Dim, Simd>(), box<Dim, Simd>(sites), sites.back());
+  leaf->store_sites(sites);
+  leaf->update_moments();
   return leaf;
 }
 
@@ -2,6 +2,18 @@
 
 namespace pivot {
 
+namespace {
+
+// Labels a leaf by the range of sites it holds.
+std::string leaf_label(int first, int num_sites) {
+  if (num_sites == 1) {
+    return std::to_string(first);
+  }
+  return std::to_string(first) + ".." + std::to_string(first + num_sites - 1);
+}
+
+} // namespace
+
 template <int Dim, bool Simd> void walk_node<Dim, Simd>::todot(const std::string &path) const {
   gvc_t &gvc = gvc_t::load();
   cgraph_t &cgraph = cgraph_t::load();
@@ -34,23 +46,23 @@ template <int Dim, bool Simd> Agnode_t *walk_node<Dim, Simd>::todot(Agraph_t *g,
   label += "end: " + end_.to_string() + "\\l";
   cgraph.agset(node, (char *)"label", (char *)label.c_str());
 
-  if (left_ != nullptr) {
+  if (auto left = this->left(); left != nullptr) {
     Agnode_t *left_node;
-    if (left_->is_leaf()) {
+    if (left->is_leaf()) {
       left_node = cgraph.agnode(g, (char *)(name + "L").c_str(), 1);
-      cgraph.agset(left_node, (char *)"label", (char *)std::to_string(id_ - 1).c_str());
+      cgraph.agset(left_node, (char *)"label", (char *)leaf_label(id_ - left->num_sites_, left->num_sites_).c_str());
     } else {
-      left_node = left_->todot(g, cgraph);
+      left_node = left->todot(g, cgraph);
     }
     cgraph.agedge(g, node, left_node, nullptr, 1);
   }
-  if (right_ != nullptr) {
+  if (auto right = this->right(); right != nullptr) {
     Agnode_t *right_node;
-    if (right_->is_leaf()) {
+    if (right->is_leaf()) {
       right_node = cgraph.agnode(g, (char *)(name + "R").c_str(), 1);
-      cgraph.agset(right_node, (char *)"label", (char *)std::to_string(id_).c_str());
+      cgraph.agset(right_node, (char *)"label", (char *)leaf_label(id_, right->num_sites_).c_str());
     } else {
-      right_node = right_->todot(g, cgraph);
+      right_node = right->todot(g, cgraph);
     }
     cgraph.agedge(g, node, right_node, nullptr, 1);
   }
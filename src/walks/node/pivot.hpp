@@ -1,196 +1,474 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <new>
+
+#include "counters.h"
 #include "walk_node.h"
 
 namespace pivot {
 
 /* PRIMITIVE OPERATIONS */
 
-// Note: A detail missing from Clisby's paper regarding tree rotations is that parent pointers must be updated,
-// except when the rotation is called from shuffle_intersect.
+// Note: A detail missing from Clisby's paper regarding tree rotations is that parent links must be updated.
 
-template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::rotate_left(bool set_parent) {
-  if (right_->is_leaf()) {
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::rotate_left() {
+  if (right()->is_leaf()) {
     throw std::invalid_argument("can't rotate left on a leaf node");
   }
-  auto temp_tree = right_;
-
-  // update pointers
-  right_ = temp_tree->right_;
-  if (set_parent && temp_tree->right_ != nullptr) {
-    temp_tree->right_->parent_ = this;
+  PIVOT_COUNT(++thread_counters().rotations;)
+  auto temp_tree = right();
+  auto temp_left = temp_tree->left();
+  auto temp_right = temp_tree->right();
+  auto left = this->left();
+
+  // update links
+  right_ = offset_of(temp_right);
+  if (!temp_right->is_leaf()) {
+    temp_right->set_parent(this);
   }
-  temp_tree->right_ = temp_tree->left_; // temp_tree->set_right(temp_tree->left_) sets parent unnecessarily
-  temp_tree->left_ = left_;
-  if (set_parent && left_ != nullptr) {
-    left_->parent_ = temp_tree;
+  temp_tree->right_ = temp_tree->offset_of(temp_left); // temp_tree->set_right(temp_left) sets parent unnecessarily
+  temp_tree->left_ = temp_tree->offset_of(left);
+  if (!left->is_leaf()) {
+    left->set_parent(temp_tree);
   }
-  left_ = temp_tree; // set_left(temp_tree) sets parent unnecessarily
+  left_ = offset_of(temp_tree); // set_left(temp_tree) sets parent unnecessarily
 
   // update symmetries
   auto temp_symm = symm_;
-  symm_ = temp_symm * left_->symm_;
-  left_->symm_ = temp_symm;
+  symm_ = temp_symm * temp_tree->symm_;
+  temp_tree->symm_ = temp_symm;
 
   // merge
-  left_->merge();
+  temp_tree->merge();
+  update_height();
 
   // update IDs
   int temp_id = id_;
-  id_ = left_->id_;
-  left_->id_ = temp_id;
+  id_ = temp_tree->id_;
+  temp_tree->id_ = temp_id;
 
   return this;
 }
 
-template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::rotate_right(bool set_parent) {
-  if (left_->is_leaf()) {
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::rotate_right() {
+  if (left()->is_leaf()) {
     throw std::invalid_argument("can't rotate right on a leaf node");
   }
-  auto temp_tree = left_;
-
-  // update pointers
-  left_ = temp_tree->left_;
-  if (set_parent && temp_tree->left_ != nullptr) {
-    temp_tree->left_->parent_ = this;
+  PIVOT_COUNT(++thread_counters().rotations;)
+  auto temp_tree = left();
+  auto temp_left = temp_tree->left();
+  auto temp_right = temp_tree->right();
+  auto right = this->right();
+
+  // update links
+  left_ = offset_of(temp_left);
+  if (!temp_left->is_leaf()) {
+    temp_left->set_parent(this);
   }
-  temp_tree->left_ = temp_tree->right_; // temp_tree->set_left(temp_tree->right_) sets parent unnecessarily
-  temp_tree->right_ = right_;
-  if (set_parent && right_ != nullptr) {
-    right_->parent_ = temp_tree;
+  temp_tree->left_ = temp_tree->offset_of(temp_right); // temp_tree->set_left(temp_right) sets parent unnecessarily
+  temp_tree->right_ = temp_tree->offset_of(right);
+  if (!right->is_leaf()) {
+    right->set_parent(temp_tree);
   }
-  right_ = temp_tree; // set_right(temp_tree) sets parent unnecessarily
+  right_ = offset_of(temp_tree); // set_right(temp_tree) sets parent unnecessarily
 
   // update symmetries
   auto temp_symm = symm_;
-  symm_ = right_->symm_;
-  right_->symm_ = symm_.inverse() * temp_symm;
+  symm_ = temp_tree->symm_;
+  temp_tree->symm_ = symm_.inverse() * temp_symm;
 
   // merge
-  right_->merge();
+  temp_tree->merge();
+  update_height();
 
   // update IDs
   int temp_id = id_;
-  id_ = right_->id_;
-  right_->id_ = temp_id;
+  id_ = temp_tree->id_;
+  temp_tree->id_ = temp_id;
 
   return this;
 }
 
 template <int Dim, bool Simd> void walk_node<Dim, Simd>::merge() {
-  num_sites_ = left_->num_sites_ + right_->num_sites_;
-
-  bbox_ = left_->bbox_ | (left_->end_ + symm_ * right_->bbox_);
-  end_ = left_->end_ + symm_ * right_->end_;
+  PIVOT_COUNT(++thread_counters().merges;)
+  auto left = this->left();
+  auto right = this->right();
+  num_sites_ = left->num_sites_ + right->num_sites_;
+
+  bbox_ = left->bbox_ | (left->end_ + symm_ * right->bbox_);
+  end_ = left->end_ + symm_ * right->end_;
+  update_height();
+  update_moments();
 }
 
 /* USER LEVEL OPERATIONS */
 
 template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::shuffle_up(int id) {
-  if (id < left_->num_sites_) {
-    left_->shuffle_up(id);
+  auto left = this->left();
+  if (id < left->num_sites_) {
+    left->shuffle_up(id);
     rotate_right();
-  } else if (id > left_->num_sites_) {
-    right_->shuffle_up(id - left_->num_sites_);
+  } else if (id > left->num_sites_) {
+    right()->shuffle_up(id - left->num_sites_);
     rotate_left();
   }
 
   return this;
 }
 
-template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::shuffle_down() {
-  int id = std::floor((num_sites_ + 1) / 2.0);
-  if (id < left_->num_sites_) {
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::shuffle_down(int leaf_size) {
+  int num_blocks = (num_sites_ + leaf_size - 1) / leaf_size;
+  int id = leaf_size * ((num_blocks + 1) / 2);
+  if (id < left()->num_sites_) {
     rotate_right();
-    right_->shuffle_down();
-  } else if (id > left_->num_sites_) {
+    right()->shuffle_down(leaf_size);
+    update_height();
+  } else if (id > left()->num_sites_) {
     rotate_left();
-    left_->shuffle_down();
+    left()->shuffle_down(leaf_size);
+    update_height();
   }
 
   return this;
 }
 
 template <int Dim, bool Simd> bool walk_node<Dim, Simd>::intersect() const {
-  return ::pivot::intersect<Dim, Simd>(left_, right_, point<Dim, Simd>(), left_->end_, transform<Dim, Simd>(), symm_);
+  return ::pivot::intersect<Dim, Simd>(left(), right(), point<Dim, Simd>(), left()->end_, transform<Dim, Simd>(),
+                                       symm_);
 }
 
+namespace {
+
+// Two subwalks, placed by their anchors and symmetries, whose bounding boxes are known to intersect.
+template <int Dim, bool Simd> struct intersect_frame {
+  const walk_node<Dim, Simd> *l_walk;
+  const walk_node<Dim, Simd> *r_walk;
+  point<Dim, Simd> l_anchor;
+  point<Dim, Simd> r_anchor;
+  transform<Dim, Simd> l_symm;
+  transform<Dim, Simd> r_symm;
+};
+
+// At most one frame is pending per level of each tree, so this suffices for balanced trees with up to 2^32 sites.
+// Searches that need more frames continue in a recursive call.
+constexpr int intersect_stack_size = 64;
+
+template <int Dim, bool Simd> void prefetch_children(const walk_node<Dim, Simd> *node) {
+  __builtin_prefetch(node->left());
+  __builtin_prefetch(node->right());
+}
+
+} // namespace
+
 template <int Dim, bool Simd>
 bool intersect(const walk_node<Dim, Simd> *l_walk, const walk_node<Dim, Simd> *r_walk, const point<Dim, Simd> &l_anchor,
                const point<Dim, Simd> &r_anchor, const transform<Dim, Simd> &l_symm,
                const transform<Dim, Simd> &r_symm) {
+  using frame = intersect_frame<Dim, Simd>;
+  PIVOT_COUNT(auto &stats = thread_counters(); ++stats.intersect_calls; ++stats.box_tests;)
+
   auto l_box = l_anchor + l_symm * l_walk->bbox_;
   auto r_box = r_anchor + r_symm * r_walk->bbox_;
   if ((l_box & r_box).empty()) {
     return false;
   }
 
-  if (l_walk->num_sites_ <= 2 && r_walk->num_sites_ <= 2) {
-    return true;
+  // Frames are constructed as they are pushed rather than all at once, since most searches end after a few steps.
+  alignas(frame) std::byte storage[intersect_stack_size * sizeof(frame)];
+  auto stack = std::launder(reinterpret_cast<frame *>(storage));
+  int size = 0;
+  // number of splits from (l_walk, r_walk) to the current frame and to each pending one
+  PIVOT_COUNT(int depth = 0; std::array<int, intersect_stack_size> depths;)
+  auto push = [&](const frame &f) {
+    if (size == intersect_stack_size) {
+      return intersect(f.l_walk, f.r_walk, f.l_anchor, f.r_anchor, f.l_symm, f.r_symm);
+    }
+    PIVOT_COUNT(depths[size] = depth;)
+    new (stack + size++) frame(f);
+    return false;
+  };
+
+  // The subwalk with more sites (other than a leaf) is split and both of its children are tested against the other
+  // subwalk at once. Children whose boxes intersect the other subwalk's box are searched in the same order as a
+  // recursive search would. Pairs of leaves are compared site by site.
+  frame cur{l_walk, r_walk, l_anchor, r_anchor, l_symm, r_symm};
+  while (true) {
+    PIVOT_COUNT(++stats.nodes_visited; stats.max_depth = std::max(stats.max_depth, depth);)
+    if (cur.l_walk->num_sites_ <= 2 && cur.r_walk->num_sites_ <= 2) {
+      return true;
+    }
+
+    auto l_leaf = cur.l_walk->is_leaf();
+    auto r_leaf = cur.r_walk->is_leaf();
+    if (l_leaf && r_leaf) {
+      PIVOT_COUNT(++stats.leaf_tests;)
+      if (walk_node<Dim, Simd>::leaf_intersect(cur.l_walk, cur.r_walk, cur.l_anchor, cur.r_anchor, cur.l_symm,
+                                               cur.r_symm)) {
+        return true;
+      }
+    } else if (r_leaf || (!l_leaf && cur.l_walk->num_sites_ >= cur.r_walk->num_sites_)) {
+      auto l_left = cur.l_walk->left();
+      auto l_right = cur.l_walk->right();
+      prefetch_children(l_left);
+      prefetch_children(l_right);
+      auto right_anchor = cur.l_anchor + cur.l_symm * l_left->end_;
+      auto right_symm = cur.l_symm * cur.l_walk->symm_;
+      auto right_box = right_anchor + right_symm * l_right->bbox_;
+      auto left_box = cur.l_anchor + cur.l_symm * l_left->bbox_;
+      auto [right_disjoint, left_disjoint] = r_box.disjoint(right_box, left_box);
+      PIVOT_COUNT(stats.box_tests += 2; ++depth;)
+      if (!right_disjoint) {
+        if (!left_disjoint && push({l_left, cur.r_walk, cur.l_anchor, cur.r_anchor, cur.l_symm, cur.r_symm})) {
+          return true;
+        }
+        cur = {l_right, cur.r_walk, right_anchor, cur.r_anchor, right_symm, cur.r_symm};
+        l_box = right_box;
+        continue;
+      }
+      if (!left_disjoint) {
+        cur.l_walk = l_left;
+        l_box = left_box;
+        continue;
+      }
+    } else {
+      auto r_left = cur.r_walk->left();
+      auto r_right = cur.r_walk->right();
+      prefetch_children(r_left);
+      prefetch_children(r_right);
+      auto right_anchor = cur.r_anchor + cur.r_symm * r_left->end_;
+      auto right_symm = cur.r_symm * cur.r_walk->symm_;
+      auto right_box = right_anchor + right_symm * r_right->bbox_;
+      auto left_box = cur.r_anchor + cur.r_symm * r_left->bbox_;
+      auto [left_disjoint, right_disjoint] = l_box.disjoint(left_box, right_box);
+      PIVOT_COUNT(stats.box_tests += 2; ++depth;)
+      if (!left_disjoint) {
+        if (!right_disjoint && push({cur.l_walk, r_right, cur.l_anchor, right_anchor, cur.l_symm, right_symm})) {
+          return true;
+        }
+        cur.r_walk = r_left;
+        r_box = left_box;
+        continue;
+      }
+      if (!right_disjoint) {
+        cur = {cur.l_walk, r_right, cur.l_anchor, right_anchor, cur.l_symm, right_symm};
+        r_box = right_box;
+        continue;
+      }
+    }
+
+    if (size == 0) {
+      return false;
+    }
+    cur = stack[--size];
+    PIVOT_COUNT(depth = depths[size];)
+    l_box = cur.l_anchor + cur.l_symm * cur.l_walk->bbox_;
+    r_box = cur.r_anchor + cur.r_symm * cur.r_walk->bbox_;
+  }
+}
+
+template <int Dim, bool Simd>
+bool walk_node<Dim, Simd>::leaf_intersect(const walk_node *l_leaf, const walk_node *r_leaf,
+                                          const point<Dim, Simd> &l_anchor, const point<Dim, Simd> &r_anchor,
+                                          const transform<Dim, Simd> &l_symm, const transform<Dim, Simd> &r_symm) {
+  int l_num_sites = l_leaf->num_sites_;
+  std::array<site_key, max_leaf_size> l_keys;
+  for (int i = 0; i < l_num_sites; ++i) {
+    l_keys[i] = l_leaf->key(i);
   }
 
-  if (l_walk->num_sites_ >= r_walk->num_sites_) {
-    return intersect(l_walk->right_, r_walk, l_anchor + l_symm * l_walk->left_->end_, r_anchor, l_symm * l_walk->symm_,
-                     r_symm) ||
-           intersect(l_walk->left_, r_walk, l_anchor, r_anchor, l_symm, r_symm);
-  } else {
-    return intersect(l_walk, r_walk->left_, l_anchor, r_anchor, l_symm, r_symm) ||
-           intersect(l_walk, r_walk->right_, l_anchor, r_anchor + r_symm * r_walk->left_->end_, l_symm,
-                     r_symm * r_walk->symm_);
+  // sites of the right leaf are compared against all sites of the left one at once, in the frame of the left one
+  auto l_inv = l_symm.inverse();
+  auto symm = l_inv * r_symm;
+  auto anchor = l_inv * (r_anchor - l_anchor);
+  for (int i = 0; i < r_leaf->num_sites_; ++i) {
+    auto key = pack(anchor + symm * r_leaf->site(i));
+    int matches = 0;
+    for (int j = 0; j < l_num_sites; ++j) {
+      matches += l_keys[j] == key;
+    }
+    if (matches > 0) {
+      return true;
+    }
   }
+  return false;
+}
+
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_node<Dim, Simd>::split_into(int i, walk_node *dest) const {
+  std::array<point<Dim, Simd>, max_leaf_size> sites;
+  for (int j = 0; j < num_sites_; ++j) {
+    sites[j] = site(j);
+  }
+
+  // sites from the i-th one onward are placed in the frame of the new node, as in balanced_rep
+  auto symm = transform(sites[i - 1], sites[i]);
+  auto inv = symm.inverse();
+  for (int j = i; j < num_sites_; ++j) {
+    sites[j] = inv * (sites[j] - sites[i - 1]);
+  }
+  auto left = create_leaf(id_, std::span(sites.data(), i), dest + 1);
+  auto right = create_leaf(id_ + i, std::span(sites.data() + i, num_sites_ - i), dest + 1 + leaf_slots(i));
+
+  auto node = new (dest) walk_node(id_ + i, num_sites_, symm, bbox_, end_);
+  node->set_left(left);
+  node->set_right(right);
+  node->height_ = 1;
+  node->update_moments();
+  return node;
 }
 
 template <int Dim, bool Simd>
-bool walk_node<Dim, Simd>::shuffle_intersect(const transform<Dim, Simd> &t, std::optional<bool> is_left_child) {
-  return shuffle_intersect(t, std::nullopt, is_left_child);
+transform<Dim, Simd> walk_node<Dim, Simd>::pivot_leaf(int i, const transform<Dim, Simd> &t) {
+  if (!is_leaf()) {
+    auto r = right()->pivot_leaf(i, t);
+    merge();
+    return symm_ * r * symm_.inverse();
+  }
+
+  std::array<point<Dim, Simd>, max_leaf_size> sites;
+  for (int j = 0; j < num_sites_; ++j) {
+    sites[j] = site(j);
+  }
+  auto symm = transform(sites[i - 1], sites[i]);
+  auto r = symm * t * symm.inverse();
+  for (int j = i; j < num_sites_; ++j) {
+    sites[j] = sites[i - 1] + r * (sites[j] - sites[i - 1]);
+  }
+  std::span<const point<Dim, Simd>> new_sites(sites.data(), num_sites_);
+  bbox_ = box<Dim, Simd>(new_sites);
+  end_ = new_sites.back();
+  store_sites(new_sites);
+  update_moments();
+  return r;
+}
+
+namespace {
+
+// A subwalk on one side of the pivot site, placed in the frame of the node being pivoted about, together with the box
+// and number of sites of all subwalks on the same side up to and including it.
+template <int Dim, bool Simd> struct shuffle_part {
+  const walk_node<Dim, Simd> *walk;
+  point<Dim, Simd> anchor;
+  transform<Dim, Simd> symm;
+  box<Dim, Simd> side_box;
+  int side_sites;
+};
+
+// Besides the children of the node being pivoted about, each of its ancestors adds one part to one of the sides.
+template <int Dim, bool Simd> constexpr int shuffle_stack_size = walk_node<Dim, Simd>::max_height + 2;
+
+} // namespace
+
+template <int Dim, bool Simd> bool walk_node<Dim, Simd>::shuffle_intersect(const transform<Dim, Simd> &t) const {
+  return shuffle_intersect(t, is_left_child());
 }
 
 template <int Dim, bool Simd>
-bool walk_node<Dim, Simd>::shuffle_intersect(const transform<Dim, Simd> &t, std::optional<bool> was_left_child,
-                                             std::optional<bool> is_left_child) {
-  /* BASE CASE */
-  if (was_left_child.has_value()) {
-    if (was_left_child.value()) {
-      if (::pivot::intersect(left_, right_->right_, point<Dim, Simd>(), left_->end_ + symm_ * t * right_->left_->end_,
-                             transform<Dim, Simd>(), symm_ * t * right_->symm_)) {
+bool walk_node<Dim, Simd>::shuffle_intersect(const transform<Dim, Simd> &t, std::optional<bool> is_left_child) const {
+  using part = shuffle_part<Dim, Simd>;
+  PIVOT_COUNT(auto &stats = thread_counters(); ++stats.shuffle_tests;)
+
+  // Note: Clisby's paper rotates copies of the ancestors so that the sites before and after the pivot site end up in
+  // the left and right subtrees of a copy of the root. Only the subwalks on either side and the boxes of the subtrees
+  // built by the rotations are actually needed, so they are accumulated in the frame of the current node instead.
+  alignas(part) std::byte l_storage[shuffle_stack_size<Dim, Simd> * sizeof(part)];
+  alignas(part) std::byte r_storage[shuffle_stack_size<Dim, Simd> * sizeof(part)];
+  auto l_parts = std::launder(reinterpret_cast<part *>(l_storage));
+  auto r_parts = std::launder(reinterpret_cast<part *>(r_storage));
+  int l_size = 0;
+  int r_size = 0;
+
+  // Checks a subwalk against the parts of a side up to the given one, given that their box intersects that of the
+  // subwalk. As when searching the subtree that rotations would build from those parts, the larger of the two is split
+  // and parts closer to the pivot site are searched first.
+  auto search = [PIVOT_COUNT(&stats)](auto &self, const part *side, int top, const walk_node *walk,
+                                      const point<Dim, Simd> &anchor, const transform<Dim, Simd> &symm,
+                                      const box<Dim, Simd> &walk_box, bool on_left) -> bool {
+    if (!walk->is_leaf() && walk->num_sites_ > side[top].side_sites) {
+      PIVOT_COUNT(++stats.nodes_visited; stats.box_tests += 2;)
+      auto left = walk->left();
+      auto right = walk->right();
+      auto right_anchor = anchor + symm * left->end_;
+      auto right_symm = symm * walk->symm_;
+      auto left_box = anchor + symm * left->bbox_;
+      auto right_box = right_anchor + right_symm * right->bbox_;
+      auto [left_disjoint, right_disjoint] = side[top].side_box.disjoint(left_box, right_box);
+      auto search_left = [&] {
+        return !left_disjoint && self(self, side, top, left, anchor, symm, left_box, on_left);
+      };
+      auto search_right = [&] {
+        return !right_disjoint && self(self, side, top, right, right_anchor, right_symm, right_box, on_left);
+      };
+      return on_left ? search_right() || search_left() : search_left() || search_right();
+    }
+    PIVOT_COUNT(stats.box_tests += top > 0;)
+    if (top > 0 && !(side[top - 1].side_box & walk_box).empty() &&
+        self(self, side, top - 1, walk, anchor, symm, walk_box, on_left)) {
+      return true;
+    }
+    const auto &o = side[top];
+    return on_left ? ::pivot::intersect(walk, o.walk, anchor, o.anchor, symm, o.symm)
+                   : ::pivot::intersect(o.walk, walk, o.anchor, anchor, o.symm, symm);
+  };
+
+  // Checks a new part against the parts on the other side and then adds it to its own side.
+  auto add = [&search PIVOT_COUNT(, &stats)](part *side, int &size, const part *other, int other_size,
+                                             const walk_node *walk, const point<Dim, Simd> &anchor,
+                                             const transform<Dim, Simd> &symm, bool on_left) {
+    auto walk_box = anchor + symm * walk->bbox_;
+    int top = other_size - 1;
+    PIVOT_COUNT(stats.box_tests += top >= 0;)
+    if (top >= 0 && !(other[top].side_box & walk_box).empty() &&
+        search(search, other, top, walk, anchor, symm, walk_box, on_left)) {
+      return true;
+    }
+    if (size == 0) {
+      new (side) part{walk, anchor, symm, walk_box, walk->num_sites_};
+    } else {
+      const auto &prev = side[size - 1];
+      new (side + size) part{walk, anchor, symm, walk_box | prev.side_box, walk->num_sites_ + prev.side_sites};
+    }
+    ++size;
+    return false;
+  };
+
+  // the pivot in the frame of the current node, which moves a subwalk placed at (anchor, symm) to
+  // (pivot + pivot_symm * (anchor - pivot), pivot_symm * symm)
+  auto pivot = left()->end_;
+  auto pivot_symm = symm_ * t * symm_.inverse();
+  add(l_parts, l_size, r_parts, r_size, left(), point<Dim, Simd>(), transform<Dim, Simd>(), true);
+  if (add(r_parts, r_size, l_parts, l_size, right(), pivot, symm_ * t, false)) {
+    PIVOT_COUNT(++stats.collision_levels[0];)
+    return true;
+  }
+
+  // maps the frame of the current ancestor to that of the current node
+  point<Dim, Simd> anchor;
+  transform<Dim, Simd> symm;
+  auto node = this;
+  PIVOT_COUNT(int level = 0;)
+  while (is_left_child.has_value()) {
+    auto parent = node->parent();
+    PIVOT_COUNT(level = std::min(level + 1, counters::max_level);)
+    if (is_left_child.value()) {
+      auto sibling_anchor = anchor + symm * parent->left()->end_;
+      if (add(r_parts, r_size, l_parts, l_size, parent->right(), pivot + pivot_symm * (sibling_anchor - pivot),
+              pivot_symm * symm * parent->symm_, false)) {
+        PIVOT_COUNT(++stats.collision_levels[level];)
         return true;
       }
     } else {
-      if (::pivot::intersect(left_->left_, right_, point<Dim, Simd>(), left_->end_, transform<Dim, Simd>(),
-                             symm_ * t)) {
+      symm = symm * parent->symm_.inverse();
+      anchor = anchor - symm * parent->left()->end_;
+      if (add(l_parts, l_size, r_parts, r_size, parent->left(), anchor, symm, true)) {
+        PIVOT_COUNT(++stats.collision_levels[level];)
         return true;
       }
     }
-  } else {
-    if (::pivot::intersect(left_, right_, point<Dim, Simd>(), left_->end_, transform<Dim, Simd>(), symm_ * t)) {
-      return true;
-    }
+    is_left_child = parent->is_left_child();
+    node = parent;
   }
-
-  if (parent_ == nullptr) {
-    return false;
-  }
-
-  /* RECURSION */
-  auto is_left_child_new = parent_->is_left_child();
-
-  // Note: A detail left out in Clisby's paper is that the left or right sub-node must also be copied
-  // and the copied parent node must be have its left and right children updated. This is to avoid
-  // modifying the original tree when performing a right or left rotation.
-  walk_node w(*parent_);
-  bool result = false;
-  if (is_left_child.value()) {
-    auto w1 = parent_->right_->is_leaf() ? leaf() : walk_node(*parent_->right_);
-    w.set_left(this);
-    w.set_right(&w1);
-    w.rotate_right(false);
-    result = w.shuffle_intersect(t, is_left_child, is_left_child_new);
-  } else {
-    auto w1 = parent_->left_->is_leaf() ? leaf() : walk_node(*parent_->left_);
-    w.set_left(&w1);
-    w.set_right(this);
-    w.rotate_left(false);
-    result = w.shuffle_intersect(t, is_left_child, is_left_child_new);
-  }
-  return result;
+  return false;
 }
 
 } // namespace pivot
@@ -2,48 +2,13 @@
 
 #include <boost/preprocessor/repetition/repeat_from_to.hpp>
 
-#include "walk_node.h"
-
 #include "ctors.hpp"
 #include "graphviz.hpp"
 #include "pivot.hpp"
-
-#ifdef ENABLE_AVX2
-#include "lattice_simd.h"
-#endif
+#include "walk_node.hpp"
 
 namespace pivot {
 
-template <int Dim, bool Simd> bool walk_node<Dim, Simd>::operator==(const walk_node &other) const {
-  if (is_leaf() && other.is_leaf()) {
-    return true;
-  }
-  return id_ == other.id_ && num_sites_ == other.num_sites_ && symm_ == other.symm_ && bbox_ == other.bbox_ &&
-         end_ == other.end_ && *left_ == *other.left_ && *right_ == *other.right_;
-}
-
-template <int Dim, bool Simd> bool walk_node<Dim, Simd>::is_leaf() const {
-  return left_ == nullptr && right_ == nullptr;
-}
-
-template <int Dim, bool Simd> std::vector<point<Dim, Simd>> walk_node<Dim, Simd>::steps() const {
-  std::vector<point<Dim, Simd>> result;
-  if (is_leaf()) {
-    result.push_back(end_);
-    return result;
-  }
-
-  auto left_steps = left_->steps();
-  result.insert(result.begin(), left_steps.begin(), left_steps.end());
-
-  auto right_steps = right_->steps();
-  for (auto &step : right_steps) {
-    result.push_back(left_->end_ + symm_ * step);
-  }
-
-  return result;
-}
-
 #define INTERSECT_INST(z, n, data)                                                                                     \
   template bool intersect<n>(const walk_node<n> *l_walk, const walk_node<n> *r_walk, const point<n> &l_anchor,         \
                              const point<n> &r_anchor, const transform<n> &l_symm, const transform<n> &r_symm);
@@ -53,11 +18,4 @@ template <int Dim, bool Simd> std::vector<point<Dim, Simd>> walk_node<Dim, Simd>
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, INTERSECT_INST, ~)
 BOOST_PP_REPEAT_FROM_TO(1, DIMS_UB, WALK_NODE_INST, ~)
 
-#ifdef ENABLE_AVX2
-template bool intersect<2, true>(const walk_node<2, true> *l_walk, const walk_node<2, true> *r_walk,
-                                 const point<2, true> &l_anchor, const point<2, true> &r_anchor,
-                                 const transform<2, true> &l_symm, const transform<2, true> &r_symm);
-template class walk_node<2, true>;
-#endif
-
 } // namespace pivot
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "walk_node.h"
+
+namespace pivot {
+
+template <int Dim, bool Simd> bool walk_node<Dim, Simd>::operator==(const walk_node &other) const {
+  if (is_leaf() || other.is_leaf()) {
+    if (!is_leaf() || !other.is_leaf() || num_sites_ != other.num_sites_) {
+      return false;
+    }
+    for (int i = 0; i < num_sites_; ++i) {
+      if (site(i) != other.site(i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return id_ == other.id_ && num_sites_ == other.num_sites_ && symm_ == other.symm_ && bbox_ == other.bbox_ &&
+         end_ == other.end_ && *left() == *other.left() && *right() == *other.right();
+}
+
+template <int Dim, bool Simd> bool walk_node<Dim, Simd>::is_leaf() const {
+  return left_ == 0 && right_ == 0;
+}
+
+template <int Dim, bool Simd> std::vector<point<Dim, Simd>> walk_node<Dim, Simd>::steps() const {
+  std::vector<point<Dim, Simd>> result;
+  if (is_leaf()) {
+    for (int i = 0; i < num_sites_; ++i) {
+      result.push_back(site(i));
+    }
+    return result;
+  }
+
+  auto left_steps = left()->steps();
+  result.insert(result.begin(), left_steps.begin(), left_steps.end());
+
+  auto right_steps = right()->steps();
+  for (auto &step : right_steps) {
+    result.push_back(left()->end_ + symm_ * step);
+  }
+
+  return result;
+}
+
+template <int Dim, bool Simd> void walk_node<Dim, Simd>::update_moments() {
+#ifdef ENABLE_OBSERVABLES
+  if (is_leaf()) {
+    site_sum_ = {};
+    site_sum_sq_ = 0;
+    for (int i = 0; i < num_sites_; ++i) {
+      auto p = site(i);
+      for (int j = 0; j < Dim; ++j) {
+        site_sum_[j] += p[j];
+        site_sum_sq_ += p[j] * p[j];
+      }
+    }
+    return;
+  }
+
+  // the sites of the right child are moved by x -> e + S x, where e is the endpoint of the left child and S permutes
+  // and flips coordinates, so that their sum becomes n e + S s and their squared norms add up to n |e|^2 + 2 e.S s + q
+  std::array<int, Dim> axes;
+  for (int j = 0; j < Dim; ++j) {
+    axes[j] = j + 1;
+  }
+  // the k-th coordinate of S x is x[|a[k]| - 1], flipped if a[k] is negative
+  auto a = symm_ * point<Dim, Simd>(axes);
+  const auto &e = left()->end_;
+  const auto &l = *left();
+  const auto &r = *right();
+  double n = r.num_sites_;
+  std::array<double, Dim> sum;
+  double sum_sq = l.site_sum_sq_ + r.site_sum_sq_;
+  for (int k = 0; k < Dim; ++k) {
+    int a_k = a[k];
+    double e_k = e[k];
+    double moved = std::copysign(1.0, a_k) * r.site_sum_[std::abs(a_k) - 1];
+    sum[k] = l.site_sum_[k] + n * e_k + moved;
+    sum_sq += e_k * (n * e_k + 2 * moved);
+  }
+  site_sum_ = sum;
+  site_sum_sq_ = sum_sq;
+#endif
+}
+
+/* LEAVES */
+
+template <int Dim, bool Simd> void walk_node<Dim, Simd>::store_sites(std::span<const point<Dim, Simd>> sites) {
+  if (num_sites_ == 1) {
+    return;
+  }
+  auto leaf_coords = coords();
+  for (int i = 0; i < num_sites_; ++i) {
+    for (int j = 0; j < Dim; ++j) {
+      leaf_coords[i * Dim + j] = sites[i][j];
+    }
+  }
+}
+
+template <int Dim, bool Simd> point<Dim, Simd> walk_node<Dim, Simd>::site(int i) const {
+  if (num_sites_ == 1) {
+    return end_;
+  }
+  std::array<int, Dim> result;
+  auto site_coords = coords() + i * Dim;
+  for (int j = 0; j < Dim; ++j) {
+    result[j] = site_coords[j];
+  }
+  return point<Dim, Simd>(result);
+}
+
+template <int Dim, bool Simd> typename walk_node<Dim, Simd>::site_key walk_node<Dim, Simd>::key(int i) const {
+  if (num_sites_ == 1) {
+    return pack(end_);
+  }
+  site_key result{};
+  std::memcpy(&result, coords() + i * Dim, Dim);
+  return result;
+}
+
+template <int Dim, bool Simd>
+typename walk_node<Dim, Simd>::site_key walk_node<Dim, Simd>::pack(const point<Dim, Simd> &p) {
+  std::array<std::int8_t, Dim> packed;
+  for (int j = 0; j < Dim; ++j) {
+    packed[j] = std::clamp(p[j], -128, 127);
+  }
+  site_key result{};
+  std::memcpy(&result, packed.data(), Dim);
+  return result;
+}
+
+} // namespace pivot
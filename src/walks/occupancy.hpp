@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "occupancy.h"
+
+namespace pivot {
+
+template <int Dim, bool Simd>
+  requires(Dim <= 3)
+void grid_occupancy<Dim, Simd>::reset(const std::vector<point<Dim, Simd>> &steps) {
+  std::array<int, Dim> lo, hi;
+  lo.fill(steps.empty() ? 0 : std::numeric_limits<int>::max());
+  hi.fill(steps.empty() ? 0 : std::numeric_limits<int>::min());
+  for (const auto &p : steps) {
+    for (int i = 0; i < Dim; ++i) {
+      lo[i] = std::min(lo[i], p[i]);
+      hi[i] = std::max(hi[i], p[i]);
+    }
+  }
+
+  // The margin leaves room for the walk to move without recentring the grid too often.
+  std::array<double, Dim> size;
+  double num_cells = 1;
+  for (int i = 0; i < Dim; ++i) {
+    size[i] = 2.0 * (hi[i] - lo[i]) + 5;
+    num_cells *= size[i];
+  }
+  double max_cells = std::max<double>(1 << 22, 64.0 * steps.size());
+  double scale = num_cells > max_cells ? std::pow(max_cells / num_cells, 1.0 / Dim) : 1;
+
+  std::ptrdiff_t stride = 1;
+  for (int i = 0; i < Dim; ++i) {
+    size_[i] = std::max(1, static_cast<int>(size[i] * scale));
+    lo_[i] = lo[i] + (hi[i] - lo[i]) / 2 - static_cast<int>(size_[i] / 2);
+    stride_[i] = stride;
+    stride *= size_[i];
+  }
+  bits_.assign((stride + 63) / 64, 0);
+  index_.resize(stride);
+  outside_.clear();
+  for (int i = 0; i < static_cast<int>(steps.size()); ++i) {
+    insert(steps[i], i);
+  }
+  // Shortly after starting from a straight line, the walk can be so spread out that the grid holds few of its sites. It
+  // is then rebuilt after each pivot, until the walk is compact enough to fit.
+  auto num_inside = steps.size() - outside_.size();
+  max_outside_ = std::min(outside_.size() + std::max<std::size_t>(num_inside / 8, 1), steps.size() - 1);
+}
+
+} // namespace pivot
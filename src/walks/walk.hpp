@@ -0,0 +1,303 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "defines.h"
+#include "utils.h"
+#include "walk.h"
+
+namespace pivot {
+
+template <int Dim, bool Simd, class Occupancy>
+walk<Dim, Simd, Occupancy>::walk(const std::vector<point<Dim, Simd>> &steps, std::optional<unsigned int> seed)
+    : steps_(steps), occupied_(steps), new_points_(steps.size() / 2) {
+  queue_ = proposal_queue<Dim, Simd>(proposal_streams(seed.value_or(std::random_device()())), 0, num_steps() - 1);
+}
+
+template <int Dim, bool Simd, class Occupancy>
+walk<Dim, Simd, Occupancy>::walk(int num_steps, std::optional<unsigned int> seed)
+    : walk(line<Dim, Simd>(num_steps), seed) {}
+
+template <int Dim, bool Simd, class Occupancy>
+walk<Dim, Simd, Occupancy>::walk(const std::string &path, std::optional<unsigned int> seed)
+    : walk(from_file<Dim, Simd>(path), seed) {}
+
+template <int Dim, bool Simd, class Occupancy>
+walk<Dim, Simd, Occupancy>::walk(const checkpoint<Dim, Simd> &data, std::optional<unsigned int> seed)
+    : walk(data.steps, seed) {
+  if (!seed.has_value() && !data.rng_state.empty()) {
+    std::istringstream state(data.rng_state);
+    if (!(state >> queue_)) {
+      throw std::runtime_error("invalid random engine state in checkpoint");
+    }
+  }
+}
+
+template <int Dim, bool Simd, class Occupancy> std::vector<point<Dim, Simd>> walk<Dim, Simd, Occupancy>::steps() const {
+  std::vector<point<Dim, Simd>> result(num_steps());
+  for (int i = 0; i < num_steps(); ++i) {
+    result[i] = (*this)[i];
+  }
+  return result;
+}
+
+template <int Dim, bool Simd, class Occupancy>
+std::optional<std::vector<point<Dim, Simd>>>
+walk<Dim, Simd, Occupancy>::try_pivot(int step, const transform<Dim, Simd> &trans) const {
+  std::pair<int, int> collision;
+  if (!test_pivot(step, local(trans), collision)) {
+    return {};
+  }
+  std::vector<point<Dim, Simd>> new_points(num_steps() - step - 1);
+  auto p = (*this)[step];
+  for (int i = step + 1; i < num_steps(); ++i) {
+    new_points[i - step - 1] = p + trans * ((*this)[i] - p);
+  }
+  return new_points;
+}
+
+template <int Dim, bool Simd, class Occupancy>
+bool walk<Dim, Simd, Occupancy>::try_pivot(int step, const transform<Dim, Simd> &trans,
+                                           std::vector<point<Dim, Simd>> &new_points, std::pair<int, int> &collision,
+                                           bool fast) const {
+  auto u = local(trans);
+  if (!(fast ? test_pivot_fast(step, u, collision) : test_pivot(step, u, collision))) {
+    return false;
+  }
+
+  // pivot whichever side is shorter: the sites after the pivot site by u, or those before it by its inverse
+  auto p = steps_[step];
+  int num_after = num_steps() - step - 1;
+  if (num_after <= step) {
+    for (int k = 1; k <= num_after; ++k) {
+      new_points[k - 1] = p + u * (steps_[step + k] - p);
+    }
+  } else {
+    auto inv = u.inverse();
+    for (int k = 1; k <= step; ++k) {
+      new_points[k - 1] = p + inv * (steps_[step - k] - p);
+    }
+  }
+  return true;
+}
+
+template <int Dim, bool Simd, class Occupancy>
+bool walk<Dim, Simd, Occupancy>::test_pivot(int step, const transform<Dim, Simd> &u,
+                                            std::pair<int, int> &collision) const {
+  if (u.is_identity()) {
+    collision = {step, step}; // rejected regardless of the rest of the walk
+    return false;
+  }
+
+  auto p = steps_[step];
+  for (int i = step + 1; i < num_steps(); ++i) {
+    auto m = occupied_.find(p + u * (steps_[i] - p));
+    if (m >= 0 && m <= step) {
+      collision = {m, i};
+      return false;
+    }
+  }
+  return true;
+}
+
+template <int Dim, bool Simd, class Occupancy>
+std::pair<int, std::optional<std::vector<point<Dim, Simd>>>> walk<Dim, Simd, Occupancy>::try_rand_pivot() const {
+  const auto &[step, r] = queue_.next();
+  return {step, try_pivot(step, r)};
+}
+
+template <int Dim, bool Simd, class Occupancy>
+bool walk<Dim, Simd, Occupancy>::test_pivot_fast(int step, const transform<Dim, Simd> &trans) const {
+  std::pair<int, int> collision;
+  return test_pivot_fast(step, local(trans), collision);
+}
+
+template <int Dim, bool Simd, class Occupancy>
+bool walk<Dim, Simd, Occupancy>::test_pivot_fast(int step, const transform<Dim, Simd> &u,
+                                                 std::pair<int, int> &collision) const {
+  if (u.is_identity()) {
+    collision = {step, step}; // rejected regardless of the rest of the walk
+    return false;
+  }
+
+  // Sites i before and j after the pivot site collide if and only if j is moved onto i, or equivalently, i is moved
+  // onto j by the inverse transform, so only the shorter side needs to be visited.
+  auto p = steps_[step];
+  if (step >= num_steps() - step - 1) {
+    for (int j = step + 1; j < num_steps(); ++j) {
+      auto m = occupied_.find(p + u * (steps_[j] - p));
+      if (m >= 0 && m < step) {
+        collision = {m, j};
+        return false;
+      }
+    }
+  } else {
+    auto inv = u.inverse();
+    for (int i = step - 1; i >= 0; --i) {
+      auto m = occupied_.find(p + inv * (steps_[i] - p));
+      if (m > step) {
+        collision = {i, m};
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <int Dim, bool Simd, class Occupancy> bool walk<Dim, Simd, Occupancy>::rand_pivot(bool fast) {
+  if (pool_) {
+    return rand_pivot_parallel(fast);
+  }
+
+  const auto &[step, r] = queue_.next();
+  std::pair<int, int> collision;
+  if (!try_pivot(step, r, new_points_, collision, fast)) {
+    return false;
+  }
+  do_pivot(step, r, new_points_);
+  return true;
+}
+
+template <int Dim, bool Simd, class Occupancy> bool walk<Dim, Simd, Occupancy>::rand_pivot(int num_workers) {
+  if (num_workers != (pool_ ? pool_->size() : 0)) {
+    set_num_workers(num_workers);
+  }
+  return rand_pivot();
+}
+
+template <int Dim, bool Simd, class Occupancy> void walk<Dim, Simd, Occupancy>::set_num_workers(int num_workers) {
+  if (num_workers < 0) {
+    throw std::invalid_argument("number of workers must be non-negative");
+  }
+  // pending proposals are drawn again from the same streams
+  queue_.seek(queue_.position() - (proposals_.size() - next_proposal_));
+  proposals_.clear();
+  next_proposal_ = 0;
+  scratch_.clear();
+  if (num_workers == 0) {
+    pool_.reset();
+    return;
+  }
+
+  pool_ = std::make_unique<worker_pool>(num_workers);
+  scratch_.assign(num_workers, std::vector<point<Dim, Simd>>(num_steps() / 2));
+}
+
+template <int Dim, bool Simd, class Occupancy> bool walk<Dim, Simd, Occupancy>::rand_pivot_parallel(bool fast) {
+  if (next_proposal_ == proposals_.size() || !proposals_[next_proposal_].tested) {
+    test_proposals(fast);
+  }
+
+  auto idx = next_proposal_++;
+  const auto &p = proposals_[idx];
+  if (!p.accepted) {
+    return false;
+  }
+
+  do_pivot(p.step, p.trans, scratch_[idx % pool_->size()]);
+  for (auto i = next_proposal_; i < proposals_.size(); ++i) {
+    auto &q = proposals_[i];
+    // a collision between sites that were not moved persists. Sites moved together keep their relative position, but
+    // it is rotated, and the transform of a proposal does not commute with the rotation, so their collision may not.
+    if (q.tested && !q.accepted && q.collision.second <= p.step) {
+      continue;
+    }
+    q.tested = false;
+  }
+  return true;
+}
+
+template <int Dim, bool Simd, class Occupancy> void walk<Dim, Simd, Occupancy>::test_proposals(bool fast) {
+  constexpr size_t proposals_per_worker = 16;
+
+  proposals_.erase(proposals_.begin(), proposals_.begin() + next_proposal_);
+  next_proposal_ = 0;
+  for (auto &p : proposals_) {
+    if (p.accepted) { // the corresponding pivoted sites are about to be overwritten
+      p.tested = false;
+    }
+  }
+
+  size_t num_workers = pool_->size();
+  size_t num_kept = proposals_.size();
+  proposals_.resize(std::max(num_kept, proposals_per_worker * num_workers));
+  for (size_t i = num_kept; i < proposals_.size(); ++i) {
+    const auto &[step, r] = queue_.next();
+    proposals_[i] = {step, r, false, false, {}};
+  }
+
+  // slot i is handled by worker i % num_workers
+  pool_->run([&](int w) {
+    for (size_t i = w; i < proposals_.size(); i += num_workers) {
+      auto &p = proposals_[i];
+      if (p.tested) {
+        continue;
+      }
+      p.accepted = try_pivot(p.step, p.trans, scratch_[w], p.collision, fast);
+      p.tested = true;
+      if (p.accepted) { // keep the pivoted sites in this worker's scratch buffer
+        break;
+      }
+    }
+  });
+}
+
+template <int Dim, bool Simd, class Occupancy> bool walk<Dim, Simd, Occupancy>::self_avoiding() const {
+  for (int i = 0; i < num_steps(); ++i) {
+    for (int j = i + 1; j < num_steps(); ++j) {
+      if (steps_[i] == steps_[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <int Dim, bool Simd, class Occupancy>
+void walk<Dim, Simd, Occupancy>::export_csv(const std::string &path) const {
+  return to_csv(path, steps());
+}
+
+template <int Dim, bool Simd, class Occupancy>
+void walk<Dim, Simd, Occupancy>::export_bin(const std::string &path) const {
+  // pending proposals are drawn again when resuming from the checkpoint
+  auto queue = queue_;
+  queue.seek(queue_.position() - (proposals_.size() - next_proposal_));
+  std::ostringstream state;
+  state << queue;
+  return to_bin(path, steps(), state.str());
+}
+
+template <int Dim, bool Simd, class Occupancy>
+void walk<Dim, Simd, Occupancy>::do_pivot(int step, const transform<Dim, Simd> &trans,
+                                          const std::vector<point<Dim, Simd>> &new_points) {
+  // Only the sites on the shorter side change, along with their entries in occupied_. All entries are erased before
+  // any is inserted, since a site may move to the former position of another.
+  int num_after = num_steps() - step - 1;
+  int dir = num_after <= step ? 1 : -1;
+  int num_moved = dir > 0 ? num_after : step;
+  for (int k = 1; k <= num_moved; ++k) {
+    occupied_.erase(steps_[step + dir * k]);
+  }
+  bool fits = true;
+  for (int k = 1; k <= num_moved; ++k) {
+    steps_[step + dir * k] = new_points[k - 1];
+    fits = occupied_.insert(new_points[k - 1], step + dir * k) && fits;
+  }
+  if (!fits) {
+    occupied_.reset(steps_);
+  }
+
+  if (dir < 0) {
+    // the sites after the pivot site are moved by updating the frame, which keeps the pivot site in place
+    auto p = (*this)[step];
+    frame_ = trans * frame_;
+    offset_ = p - frame_ * steps_[step];
+  }
+}
+
+template <int Dim, bool Simd, class Occupancy>
+transform<Dim, Simd> walk<Dim, Simd, Occupancy>::local(const transform<Dim, Simd> &trans) const {
+  return frame_.inverse() * trans * frame_;
+}
+
+} // namespace pivot
@@ -0,0 +1,598 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include "counters.h"
+#include "utils.h"
+#include "walk_node.h"
+#include "walk_tree.h"
+
+namespace pivot {
+
+namespace {
+
+template <int Dim, bool Simd> walk_node<Dim, Simd> *allocate_nodes(size_t num_nodes) {
+  size_t buf_size = sizeof(walk_node<Dim, Simd>) * num_nodes;
+  constexpr auto alignment = std::align_val_t(alignof(walk_node<Dim, Simd>));
+  return static_cast<walk_node<Dim, Simd> *>(::operator new[](buf_size, alignment));
+}
+
+template <int Dim, bool Simd> void deallocate_nodes(walk_node<Dim, Simd> *buf) {
+  ::operator delete[](buf, std::align_val_t(alignof(walk_node<Dim, Simd>)));
+}
+
+// Destroys the nodes and leaves of a tree laid out by walk_node::balanced_rep (or walk_node::pivot_rep). Scratch slots
+// only ever hold copies of nodes, which own no resources.
+template <int Dim, bool Simd> void destroy_nodes(walk_node<Dim, Simd> *buf, int num_blocks, int leaf_size) {
+  std::destroy_n(buf, num_blocks);
+  if (leaf_size > 1) {
+    int leaf_slots = walk_node<Dim, Simd>::leaf_slots(leaf_size);
+    for (int j = 0; j < num_blocks; ++j) {
+      std::destroy_at(buf + num_blocks + j * leaf_slots);
+    }
+  }
+}
+
+} // namespace
+
+/* CONSTRUCTORS, DESTRUCTOR */
+
+template <int Dim, bool Simd>
+walk_tree<Dim, Simd>::walk_tree(int num_sites, std::optional<unsigned int> seed, bool balanced, int leaf_size)
+    : walk_tree(line<Dim, Simd>(num_sites), seed, balanced, leaf_size) {}
+
+template <int Dim, bool Simd>
+walk_tree<Dim, Simd>::walk_tree(const std::string &path, std::optional<unsigned int> seed, bool balanced,
+                                int leaf_size)
+    : walk_tree(from_file<Dim, Simd>(path), seed, balanced, leaf_size) {}
+
+template <int Dim, bool Simd>
+walk_tree<Dim, Simd>::walk_tree(const checkpoint<Dim, Simd> &data, std::optional<unsigned int> seed, bool balanced,
+                                int leaf_size)
+    : walk_tree(data.steps, seed, balanced, leaf_size) {
+  if (!seed.has_value() && !data.rng_state.empty()) {
+    std::istringstream state(data.rng_state);
+    if (!(state >> queue_)) {
+      throw std::runtime_error("invalid random engine state in checkpoint");
+    }
+  }
+}
+
+template <int Dim, bool Simd>
+walk_tree<Dim, Simd>::walk_tree(const std::vector<point<Dim, Simd>> &steps, std::optional<unsigned int> seed,
+                                bool balanced, int leaf_size)
+    : balanced_(balanced), leaf_size_(leaf_size) {
+  if (steps.size() < 2) {
+    throw std::invalid_argument("walk must have at least 2 sites (1 step)");
+  }
+  if (steps.size() > std::numeric_limits<std::int32_t>::max() / 2) {
+    throw std::invalid_argument("walk has too many sites");
+  }
+  if (leaf_size < 1 || leaf_size > walk_node<Dim, Simd>::max_leaf_size) {
+    throw std::invalid_argument("leaf size must be between 1 and " +
+                                std::to_string(walk_node<Dim, Simd>::max_leaf_size));
+  }
+  if (leaf_size > 1 && (!balanced || steps.size() <= static_cast<size_t>(leaf_size))) {
+    throw std::invalid_argument("leaf size greater than 1 requires a balanced tree with more sites than the leaf size");
+  }
+  num_slots_ = walk_node<Dim, Simd>::num_slots(steps.size(), leaf_size);
+  num_scratch_ = 1;
+  buf_ = allocate_nodes<Dim, Simd>(num_slots_ + num_scratch_ * scratch_size());
+  root_ = balanced ? walk_node<Dim, Simd>::balanced_rep(steps, buf_, leaf_size)
+                   : walk_node<Dim, Simd>::pivot_rep(steps, buf_);
+
+  queue_ = proposal_queue<Dim, Simd>(proposal_streams(seed.value_or(std::random_device()())), 1, steps.size() - 1);
+}
+
+template <int Dim, bool Simd> walk_tree<Dim, Simd>::~walk_tree() {
+  destroy_nodes(buf_, num_blocks(), leaf_size_);
+  deallocate_nodes(buf_);
+}
+
+/* GETTERS, SETTERS, SIMPLE UTILITIES */
+
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_tree<Dim, Simd>::root() const { return root_; }
+
+template <int Dim, bool Simd> point<Dim, Simd> walk_tree<Dim, Simd>::endpoint() const { return root_->endpoint(); }
+
+template <int Dim, bool Simd> bool walk_tree<Dim, Simd>::is_leaf() const { return root_->is_leaf(); }
+
+/* PRIMITIVE OPERATIONS */
+
+template <int Dim, bool Simd> walk_node<Dim, Simd> &walk_tree<Dim, Simd>::find_node(int n) {
+  if (!balanced_) {
+    throw std::runtime_error("find_node can only be used on trees initialized with balanced=true");
+  }
+  if (n % leaf_size_ != 0) {
+    throw std::invalid_argument("node ids must be multiples of the leaf size");
+  }
+  walk_node<Dim, Simd> &result = *block_node(n / leaf_size_);
+  assert(result.id_ == n);
+  return result;
+}
+
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_tree<Dim, Simd>::block_node(int block) const {
+  return buf_ + (slots_.empty() ? block : slots_[block]);
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::shuffle_up(walk_node<Dim, Simd> *node, int start, int id) {
+  if (slots_.empty()) {
+    node->shuffle_up(id);
+    return;
+  }
+
+  // rotations only exchange ids between the nodes on the path from the node up to the root of the subtree
+  std::array<walk_node<Dim, Simd> *, walk_node<Dim, Simd>::max_height + 2> path;
+  int path_size = 0;
+  for (auto w = block_node((start + id) / leaf_size_); w != node; w = w->parent()) {
+    path[path_size++] = w;
+  }
+  path[path_size++] = node;
+  node->shuffle_up(id);
+  for (int i = 0; i < path_size; ++i) {
+    slots_[path[i]->id_ / leaf_size_] = path[i] - buf_;
+  }
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::settle() {
+  if (slots_.empty()) {
+    root_->shuffle_down(leaf_size_);
+  } else if (root_->height_ > max_height_) {
+    rebalance(root_, 0);
+  }
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::rebalance(walk_node<Dim, Simd> *node, int start) {
+  int num_blocks = (node->num_sites_ + leaf_size_ - 1) / leaf_size_;
+  if (node->height_ <= std::bit_width(static_cast<unsigned int>(num_blocks - 1))) {
+    return;
+  }
+  // split as in walk_node::balanced_rep
+  int id = leaf_size_ * ((num_blocks + 1) / 2);
+  shuffle_up(node, start, id);
+  if (!node->left()->is_leaf()) {
+    rebalance(node->left(), start);
+  }
+  if (!node->right()->is_leaf()) {
+    rebalance(node->right(), start + id);
+  }
+  node->update_height();
+}
+
+/* HIGH-LEVEL FUNCTIONS */
+
+template <int Dim, bool Simd> bool walk_tree<Dim, Simd>::try_pivot(int n, const transform<Dim, Simd> &r) {
+  if (r.is_identity()) {
+    return false;
+  }
+  if (n % leaf_size_ != 0) {
+    return try_pivot_fast(n, r);
+  }
+
+  shuffle_up(root_, 0, n);
+  auto root_symm = root_->symm_;
+  root_->symm_ = root_->symm_ * r;
+  auto success = !root_->intersect();
+  if (!success) {
+    root_->symm_ = root_symm;
+  } else {
+    PIVOT_COUNT(++thread_counters().commits;)
+    root_->merge();
+  }
+  settle();
+  return success;
+}
+
+template <int Dim, bool Simd> bool walk_tree<Dim, Simd>::try_pivot_fast(int n, const transform<Dim, Simd> &t) {
+  auto success = test_pivot_fast(n, t, scratch(0));
+  if (success) {
+    do_pivot(n, t);
+  }
+  return success;
+}
+
+template <int Dim, bool Simd> bool walk_tree<Dim, Simd>::rand_pivot(bool fast) {
+  if (pool_) {
+    return rand_pivot_parallel();
+  }
+  const auto &[site, r] = queue_.next();
+  return fast ? try_pivot_fast(site, r) : try_pivot(site, r);
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::set_num_workers(int num_workers) {
+  if (num_workers < 0) {
+    throw std::invalid_argument("number of workers must be non-negative");
+  }
+  reserve_scratch(num_workers);
+  pool_ = num_workers > 0 ? std::make_unique<worker_pool>(num_workers) : nullptr;
+  // pending proposals are drawn again from the same streams
+  queue_.seek(queue_.position() - (proposals_.size() - next_proposal_));
+  proposals_.clear();
+  next_proposal_ = 0;
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::set_rebalance_slack(int slack) {
+  if (slack < 0) {
+    throw std::invalid_argument("rebalance slack must be non-negative");
+  }
+  if (slack > 0 && !balanced_) {
+    throw std::runtime_error("lazy rebalancing can only be used on trees initialized with balanced=true");
+  }
+  if (slack == 0 && slots_.empty()) {
+    return;
+  }
+  int num_blocks = this->num_blocks();
+  if (slots_.empty()) {
+    slots_.resize(num_blocks);
+    std::iota(slots_.begin(), slots_.end(), 0);
+  }
+  int balanced_height = std::bit_width(static_cast<unsigned int>(num_blocks - 1));
+  max_height_ = std::min(balanced_height + slack, walk_node<Dim, Simd>::max_height);
+  settle();
+}
+
+/* SCRATCH SPACE */
+
+template <int Dim, bool Simd> int walk_tree<Dim, Simd>::scratch_size() const {
+  // a node splitting a leaf, followed by its two children
+  return leaf_size_ > 1 ? 1 + 2 * walk_node<Dim, Simd>::leaf_slots(leaf_size_) : 0;
+}
+
+template <int Dim, bool Simd> int walk_tree<Dim, Simd>::num_blocks() const {
+  return (root_->num_sites_ + leaf_size_ - 1) / leaf_size_;
+}
+
+template <int Dim, bool Simd> walk_node<Dim, Simd> *walk_tree<Dim, Simd>::scratch(int block) const {
+  return buf_ + num_slots_ + block * scratch_size();
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::reserve_scratch(int num_blocks) {
+  if (num_blocks <= num_scratch_) {
+    return;
+  }
+  auto buf_size =
+      static_cast<size_t>(num_slots_) + static_cast<size_t>(num_blocks) * scratch_size();
+  if (buf_size > std::numeric_limits<std::int32_t>::max()) {
+    throw std::invalid_argument("too many workers for a walk of this length");
+  }
+  auto buf = allocate_nodes<Dim, Simd>(buf_size);
+  // links are relative, so nodes keep them when moved to the same index of another arena
+  int num_nodes = this->num_blocks();
+  for (int i = 0; i < num_nodes; ++i) {
+    new (buf + i) walk_node<Dim, Simd>(buf_[i]);
+  }
+  if (leaf_size_ > 1) {
+    int leaf_slots = walk_node<Dim, Simd>::leaf_slots(leaf_size_);
+    for (int i = num_nodes; i < num_slots_; i += leaf_slots) {
+      new (buf + i) walk_node<Dim, Simd>(buf_[i]);
+      std::memcpy(static_cast<void *>(buf + i + 1), static_cast<const void *>(buf_ + i + 1),
+                  (leaf_slots - 1) * sizeof(walk_node<Dim, Simd>));
+    }
+  }
+  root_ = buf + (root_ - buf_);
+  destroy_nodes(buf_, num_nodes, leaf_size_);
+  deallocate_nodes(buf_);
+  buf_ = buf;
+  num_scratch_ = num_blocks;
+}
+
+/* PARALLEL PROPOSALS (see Clisby and Ho (2021)) */
+
+template <int Dim, bool Simd>
+bool walk_tree<Dim, Simd>::test_pivot_fast(int n, const transform<Dim, Simd> &t, walk_node<Dim, Simd> *scratch) {
+  if (t.is_identity()) {
+    return false;
+  }
+
+  if (n % leaf_size_ == 0) {
+    return !find_node(n).shuffle_intersect(t);
+  }
+
+  // there is no node with id n, so the leaf holding site n is split into one, which is then treated as any other
+  auto [parent, is_left_child] = leaf_parent(n / leaf_size_);
+  auto leaf = is_left_child ? parent->left() : parent->right();
+  auto w = leaf->split_into(n % leaf_size_, scratch);
+  w->set_parent(parent);
+  return !w->shuffle_intersect(t, is_left_child);
+}
+
+template <int Dim, bool Simd>
+std::pair<walk_node<Dim, Simd> *, bool> walk_tree<Dim, Simd>::leaf_parent(int block) const {
+  // In order, the leaf comes right after the node with id block * leaf_size_ and right before the one with id
+  // (block + 1) * leaf_size_. One of these nodes is a descendant of the other and the leaf is a child of that one.
+  if (block > 0 && block_node(block)->right()->is_leaf()) {
+    return {block_node(block), false};
+  }
+  return {block_node(block + 1), true};
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::do_pivot(int n, const transform<Dim, Simd> &t) {
+  PIVOT_COUNT(++thread_counters().commits;)
+  if (n % leaf_size_ == 0) {
+    shuffle_up(root_, 0, n);
+    root_->symm_ = root_->symm_ * t;
+    root_->merge();
+    settle();
+    return;
+  }
+
+  // The leaf holding site n is updated and the sites following it are moved by shuffling up the node right after it,
+  // if any, and transforming its right subtree accordingly.
+  int next = (n / leaf_size_ + 1) * leaf_size_;
+  if (next >= root_->num_sites_) {
+    root_->pivot_leaf(n % leaf_size_, t);
+    return;
+  }
+  shuffle_up(root_, 0, next);
+  root_->symm_ = root_->left()->pivot_leaf(n % leaf_size_, t) * root_->symm_;
+  root_->merge();
+  settle();
+}
+
+template <int Dim, bool Simd> bool walk_tree<Dim, Simd>::rand_pivot_parallel() {
+  if (next_proposal_ == proposals_.size() || !proposals_[next_proposal_].tested) {
+    test_proposals();
+  }
+
+  const auto &p = proposals_[next_proposal_++];
+  if (p.accepted) {
+    do_pivot(p.site, p.symm);
+    // later proposals were tested against the walk as it was before this pivot
+    for (auto i = next_proposal_; i < proposals_.size(); ++i) {
+      proposals_[i].tested = false;
+    }
+  }
+  return p.accepted;
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::test_proposals() {
+  // Proposals following an accepted one are wasted work, so rounds can be large without much loss: workers stop
+  // picking up new proposals as soon as one is accepted.
+  constexpr size_t proposals_per_worker = 64;
+
+  proposals_.erase(proposals_.begin(), proposals_.begin() + next_proposal_);
+  next_proposal_ = 0;
+  size_t num_proposals = proposals_per_worker * pool_->size();
+  while (proposals_.size() < num_proposals) {
+    const auto &[site, r] = queue_.next();
+    proposals_.push_back({site, r, false, false});
+  }
+
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> first_accepted{num_proposals};
+  pool_->run([&](int worker) {
+    auto worker_scratch = scratch(worker);
+    size_t i;
+    while ((i = next.fetch_add(1)) < first_accepted.load()) {
+      auto &p = proposals_[i];
+      p.accepted = test_pivot_fast(p.site, p.symm, worker_scratch);
+      p.tested = true;
+      if (p.accepted) {
+        auto current = first_accepted.load();
+        while (i < current && !first_accepted.compare_exchange_weak(current, i)) {
+        }
+      }
+    }
+  });
+}
+
+/* OTHER FUNCTIONS */
+
+template <int Dim, bool Simd> std::vector<point<Dim, Simd>> walk_tree<Dim, Simd>::steps() const {
+  return root_->steps();
+}
+
+template <int Dim, bool Simd> point<Dim, Simd> walk_tree<Dim, Simd>::site(int i) const {
+  if (i < 0 || i >= root_->num_sites_) {
+    throw std::invalid_argument("site index out of range");
+  }
+  const walk_node<Dim, Simd> *node = root_;
+  point<Dim, Simd> offset;
+  transform<Dim, Simd> t;
+  while (!node->is_leaf()) {
+    auto left = node->left();
+    if (i < left->num_sites_) {
+      node = left;
+    } else {
+      offset = offset + t * left->end_;
+      t = t * node->symm_;
+      i -= left->num_sites_;
+      node = node->right();
+    }
+  }
+  return offset + t * node->site(i);
+}
+
+template <int Dim, bool Simd>
+std::vector<point<Dim, Simd>> walk_tree<Dim, Simd>::sites(std::span<const int> indices) const {
+  if (!std::is_sorted(indices.begin(), indices.end())) {
+    throw std::invalid_argument("site indices must be in increasing order");
+  }
+  if (!indices.empty() && (indices.front() < 0 || indices.back() >= root_->num_sites_)) {
+    throw std::invalid_argument("site index out of range");
+  }
+  std::vector<point<Dim, Simd>> result(indices.size());
+  sites(root_, point<Dim, Simd>(), transform<Dim, Simd>(), indices, 0, result.data());
+  return result;
+}
+
+template <int Dim, bool Simd> box<Dim, Simd> walk_tree<Dim, Simd>::bbox(int i, int j) const {
+  if (i < 0 || i >= j || j > root_->num_sites_) {
+    throw std::invalid_argument("range of sites must be non-empty and within the walk");
+  }
+  // a range with no cuts is a single piece, all of whose parts are joined
+  std::optional<box<Dim, Simd>> result;
+  auto emit = [&result](const box<Dim, Simd> &b, bool) { result = result ? *result | b : b; };
+  bboxes(root_, point<Dim, Simd>(), transform<Dim, Simd>(), i, j, {}, 0, false, emit);
+  return *result;
+}
+
+template <int Dim, bool Simd>
+std::vector<box<Dim, Simd>> walk_tree<Dim, Simd>::bboxes(std::span<const int> bounds) const {
+  auto unordered = std::adjacent_find(bounds.begin(), bounds.end(), std::greater_equal<int>());
+  if (bounds.size() < 2 || unordered != bounds.end()) {
+    throw std::invalid_argument("bounds of pieces must be at least 2, in strictly increasing order");
+  }
+  if (bounds.front() < 0 || bounds.back() > root_->num_sites_) {
+    throw std::invalid_argument("range of sites must be within the walk");
+  }
+  std::vector<box<Dim, Simd>> result;
+  result.reserve(bounds.size() - 1);
+  auto emit = [&result](const box<Dim, Simd> &b, bool join) {
+    if (join) {
+      result.back() = result.back() | b;
+    } else {
+      result.push_back(b);
+    }
+  };
+  bboxes(root_, point<Dim, Simd>(), transform<Dim, Simd>(), bounds.front(), bounds.back(),
+         bounds.subspan(1, bounds.size() - 2), 0, false, emit);
+  return result;
+}
+
+template <int Dim, bool Simd>
+void walk_tree<Dim, Simd>::sites(const walk_node<Dim, Simd> *node, const point<Dim, Simd> &offset,
+                                 const transform<Dim, Simd> &t, std::span<const int> indices, int base,
+                                 point<Dim, Simd> *out) const {
+  if (indices.empty()) {
+    return;
+  }
+  if (node->is_leaf()) {
+    for (std::size_t k = 0; k < indices.size(); ++k) {
+      out[k] = offset + t * node->site(indices[k] - base);
+    }
+    return;
+  }
+  auto left = node->left();
+  int mid = base + left->num_sites_;
+  auto split = std::lower_bound(indices.begin(), indices.end(), mid) - indices.begin();
+  sites(left, offset, t, indices.first(split), base, out);
+  sites(node->right(), offset + t * left->end_, t * node->symm_, indices.subspan(split), mid, out + split);
+}
+
+template <int Dim, bool Simd>
+template <typename Emit>
+void walk_tree<Dim, Simd>::bboxes(const walk_node<Dim, Simd> *node, const point<Dim, Simd> &offset,
+                                  const transform<Dim, Simd> &t, int lo, int hi, std::span<const int> cuts, int base,
+                                  bool join, Emit &emit) const {
+  if (cuts.empty() && lo == base && hi == base + node->num_sites_) {
+    emit(t * node->bbox_ + offset, join);
+    return;
+  }
+  if (node->is_leaf()) {
+    auto cut = cuts.begin();
+    std::array<interval, Dim> piece;
+    for (int i = lo; i < hi; ++i) {
+      bool first = i == lo;
+      if (cut != cuts.end() && i == *cut) {
+        emit(t * box<Dim, Simd>(piece) + offset, join);
+        join = false;
+        first = true;
+        ++cut;
+      }
+      auto p = node->site(i - base);
+      for (int k = 0; k < Dim; ++k) {
+        piece[k] = first ? interval(p[k], p[k])
+                         : interval(std::min(piece[k].left_, p[k]), std::max(piece[k].right_, p[k]));
+      }
+    }
+    emit(t * box<Dim, Simd>(piece) + offset, join);
+    return;
+  }
+
+  auto left = node->left();
+  int mid = base + left->num_sites_;
+  std::size_t split = std::lower_bound(cuts.begin(), cuts.end(), mid) - cuts.begin();
+  bool cut_at_mid = split < cuts.size() && cuts[split] == mid;
+  if (lo < mid) {
+    bboxes(left, offset, t, lo, std::min(hi, mid), cuts.first(split), base, join, emit);
+    join = !cut_at_mid;
+  }
+  if (hi > mid) {
+    bboxes(node->right(), offset + t * left->end_, t * node->symm_, std::max(lo, mid), hi,
+           cuts.subspan(split + cut_at_mid), mid, join, emit);
+  }
+}
+
+template <int Dim, bool Simd> bool walk_tree<Dim, Simd>::self_avoiding() const {
+  auto steps = this->steps();
+  for (size_t i = 0; i < steps.size(); ++i) {
+    for (size_t j = i + 1; j < steps.size(); ++j) {
+      if (steps[i] == steps[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <int Dim, bool Simd> std::pair<std::array<double, Dim>, double> walk_tree<Dim, Simd>::moments() const {
+#ifdef ENABLE_OBSERVABLES
+  // the frame of the root is that of the walk
+  return {root_->site_sum(), root_->site_sum_sq()};
+#else
+  std::array<double, Dim> sum{};
+  double sum_sq = 0;
+  for (const auto &p : steps()) {
+    for (int j = 0; j < Dim; ++j) {
+      sum[j] += p[j];
+      sum_sq += static_cast<double>(p[j]) * p[j];
+    }
+  }
+  return {sum, sum_sq};
+#endif
+}
+
+template <int Dim, bool Simd> double walk_tree<Dim, Simd>::squared_radius_of_gyration() const {
+  auto [sum, sum_sq] = moments();
+  double n = root_->num_sites_;
+  double result = sum_sq / n;
+  for (int j = 0; j < Dim; ++j) {
+    result -= (sum[j] / n) * (sum[j] / n);
+  }
+  return result;
+}
+
+template <int Dim, bool Simd> double walk_tree<Dim, Simd>::mean_squared_distance_to_endpoint() const {
+  auto [sum, sum_sq] = moments();
+  auto end = endpoint();
+  double n = root_->num_sites_;
+  double result = sum_sq;
+  for (int j = 0; j < Dim; ++j) {
+    result += end[j] * (n * end[j] - 2 * sum[j]);
+  }
+  return result / n;
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::export_csv(const std::string &path) const {
+  return to_csv(path, steps());
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::export_bin(const std::string &path) const {
+  // pending proposals are drawn again when resuming from the checkpoint
+  std::ostringstream state;
+  state << streams();
+  return to_bin(path, steps(), state.str());
+}
+
+template <int Dim, bool Simd> proposal_streams walk_tree<Dim, Simd>::streams() const {
+  auto streams = queue_.streams();
+  streams.seek(streams.position() - (proposals_.size() - next_proposal_));
+  return streams;
+}
+
+template <int Dim, bool Simd> void walk_tree<Dim, Simd>::todot(const std::string &path) const { root_->todot(path); }
+
+} // namespace pivot
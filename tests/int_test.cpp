@@ -1,8 +1,20 @@
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "counters.h"
+#include "dimerize.h"
 #include "loop.h"
+#include "sample_sink.h"
+#include "utils.h"
 #include "walk.h"
 #include "walk_node.h"
 #include "walk_tree.h"
@@ -50,10 +62,106 @@ TEST(WalkTest, Seed) {
 }
 
 TEST(WalkTest, Loop) {
-  auto ret = main_loop<2>(100, 10, true, false, 42, false, false, "", "");
+  auto ret = main_loop<2>(100, 10, {.naive = true, .fast = false, .seed = 42});
   ASSERT_EQ(ret, 0);
 }
 
+TEST(WalkTest, Parallel) {
+  std::random_device rd;
+  auto seed = rd();
+
+  walk<2> w1(100, seed);
+  walk<2> w2(100, seed);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(w1.rand_pivot(3), w2.rand_pivot(3));
+  }
+  EXPECT_TRUE(w1.self_avoiding());
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(w1[i], w2[i]);
+  }
+}
+
+TEST(WalkTest, ParallelMatchesSerial) {
+  std::random_device rd;
+  auto seed = rd();
+
+  for (int num_workers : {1, 2, 3}) {
+    for (bool fast : {true, false}) {
+      walk<3> serial(200, seed);
+      walk<3> parallel(200, seed);
+      parallel.set_num_workers(num_workers);
+      for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(serial.rand_pivot(fast), parallel.rand_pivot(fast));
+      }
+      // pending proposals are drawn again after a change of the number of workers
+      parallel.set_num_workers(num_workers + 1);
+      for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(serial.rand_pivot(fast), parallel.rand_pivot(fast));
+      }
+      EXPECT_EQ(serial.steps(), parallel.steps());
+      EXPECT_TRUE(parallel.self_avoiding());
+    }
+  }
+}
+
+TEST(WalkTest, ParallelLoop) {
+  auto ret = main_loop<2>(100, 10, {.naive = true, .fast = false, .seed = 42, .verify = true, .num_workers = 2});
+  ASSERT_EQ(ret, 0);
+}
+
+TEST(WalkTest, FastMatchesSlow) {
+  std::random_device rd;
+  auto seed = rd();
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, 199);
+
+  walk<3> w1(200, seed);
+  walk<3> w2(200, seed);
+  for (int i = 0; i < 2000; ++i) {
+    auto step = dist(gen);
+    auto t = transform<3>::rand(gen);
+    ASSERT_EQ(w1.test_pivot_fast(step, t), w1.try_pivot(step, t).has_value());
+    ASSERT_EQ(w1.rand_pivot(true), w2.rand_pivot(false));
+  }
+  EXPECT_TRUE(w1.self_avoiding());
+  for (int i = 0; i < 200; ++i) {
+    ASSERT_EQ(w1[i], w2[i]);
+  }
+}
+
+TEST(WalkTest, PivotsShorterSide) {
+  walk<3> w(101, std::random_device{}());
+  for (int i = 0; i < 2000; ++i) {
+    w.rand_pivot(static_cast<bool>(i % 2));
+  }
+  // pivots about sites past the middle move the sites before them, but the walk is anchored at its first site
+  EXPECT_EQ(w[0], (point<3>::unit(0)));
+  for (int i = 1; i < w.num_steps(); ++i) {
+    auto diff = w[i] - w[i - 1];
+    ASSERT_EQ(std::abs(diff[0]) + std::abs(diff[1]) + std::abs(diff[2]), 1);
+  }
+  EXPECT_TRUE(w.self_avoiding());
+}
+
+TEST(WalkTest, GridMatchesHash) {
+  std::random_device rd;
+  auto seed = rd();
+
+  // starting from a line, the walk soon leaves the initial grid, which is then recentred
+  walk<2> w1(300, seed);
+  walk<2, false, grid_occupancy<2>> w2(300, seed);
+  walk<3> w3(300, seed);
+  walk<3, false, grid_occupancy<3>> w4(300, seed);
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_EQ(w1.rand_pivot(static_cast<bool>(i % 2)), w2.rand_pivot(static_cast<bool>(i % 2)));
+    ASSERT_EQ(w3.rand_pivot(static_cast<bool>(i % 2)), w4.rand_pivot(static_cast<bool>(i % 2)));
+  }
+  EXPECT_TRUE(w2.self_avoiding());
+  EXPECT_TRUE(w4.self_avoiding());
+  EXPECT_EQ(w1.steps(), w2.steps());
+  EXPECT_EQ(w3.steps(), w4.steps());
+}
+
 TEST(WalkTreeTest, SelfAvoiding) {
   std::mt19937 gen(std::random_device{}());
   std::uniform_int_distribution<int> dist(0, 1);
@@ -115,6 +223,278 @@ TEST(WalkTreeTest, Seed) {
 }
 
 TEST(WalkTreeTest, Loop) {
-  auto ret = main_loop<2>(100, 10, false, true, 42, false, false, "", "");
+  auto ret = main_loop<2>(100, 10, {.seed = 42});
+  ASSERT_EQ(ret, 0);
+}
+
+namespace {
+
+template <int Dim> void expect_parallel_matches_serial(unsigned int seed, int leaf_size, int rebalance_slack) {
+  SCOPED_TRACE("dim " + std::to_string(Dim) + ", leaf size " + std::to_string(leaf_size) + ", rebalance slack " +
+               std::to_string(rebalance_slack));
+  walk_tree<Dim> serial(200, seed, true, leaf_size);
+  walk_tree<Dim> parallel(200, seed, true, leaf_size);
+  serial.set_rebalance_slack(rebalance_slack);
+  parallel.set_rebalance_slack(rebalance_slack);
+  parallel.set_num_workers(4);
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(serial.rand_pivot(), parallel.rand_pivot());
+  }
+  EXPECT_EQ(serial.steps(), parallel.steps());
+  EXPECT_TRUE(parallel.self_avoiding());
+}
+
+} // namespace
+
+TEST(WalkTreeTest, ParallelMatchesSerial) {
+  std::random_device rd;
+  auto seed = rd();
+
+  for (int leaf_size : {1, 16}) {
+    for (int rebalance_slack : {0, 3}) {
+      expect_parallel_matches_serial<2>(seed, leaf_size, rebalance_slack);
+      expect_parallel_matches_serial<3>(seed, leaf_size, rebalance_slack);
+    }
+  }
+}
+
+TEST(WalkTreeTest, ParallelLoop) {
+  auto ret = main_loop<2>(100, 10, {.seed = 42, .num_workers = 2});
+  ASSERT_EQ(ret, 0);
+}
+
+TEST(WalkTreeTest, RunMatchesRandPivot) {
+  std::random_device rd;
+  auto seed = rd();
+
+  walk_tree<2> looped(200, seed);
+  walk_tree<2> batched(200, seed);
+  int num_success = 0;
+  for (int i = 0; i < 1000; ++i) {
+    num_success += looped.rand_pivot();
+  }
+  std::vector<point<2>> endpoints;
+  ASSERT_EQ(batched.run(1000, [&endpoints](const walk_tree<2> &w) { endpoints.push_back(w.endpoint()); }),
+            num_success);
+  ASSERT_EQ(static_cast<int>(endpoints.size()), num_success);
+  EXPECT_EQ(endpoints.back(), looped.endpoint());
+  EXPECT_EQ(batched.steps(), looped.steps());
+}
+
+#ifdef ENABLE_COUNTERS
+TEST(WalkTreeTest, Counters) {
+  walk_tree<2> w(200, 42);
+  collect_counters();
+  auto num_success = w.run(1000, [](const walk_tree<2> &) {});
+  auto c = collect_counters();
+
+  // each pivot tested by shuffle_intersect is either committed or rejected at some level
+  std::uint64_t num_rejected = 0;
+  for (auto n : c.collision_levels) {
+    num_rejected += n;
+  }
+  EXPECT_EQ(c.commits, num_success);
+  EXPECT_EQ(c.shuffle_tests, c.commits + num_rejected);
+  EXPECT_GE(c.rotations, c.commits);
+  EXPECT_GE(c.box_tests, c.intersect_calls);
+  EXPECT_EQ(collect_counters().commits, 0);
+}
+#endif
+
+TEST(WalkTreeTest, LeafBlocksSelfAvoiding) {
+  std::mt19937 gen(std::random_device{}());
+  std::uniform_int_distribution<int> dist(0, 1);
+  for (int leaf_size : {2, 5, 16, 64}) {
+    for (int num_steps : {leaf_size + 1, 3 * leaf_size - 1, 300}) {
+      auto w2 = walk_tree<2>(num_steps, std::nullopt, true, leaf_size);
+      auto w3 = walk_tree<3>(num_steps, std::nullopt, true, leaf_size);
+      for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 50; j++) {
+          w2.rand_pivot(static_cast<bool>(dist(gen)));
+          w3.rand_pivot();
+        }
+        EXPECT_TRUE(w2.self_avoiding());
+        EXPECT_TRUE(w3.self_avoiding());
+      }
+    }
+  }
+}
+
+TEST(WalkTreeTest, LeafBlocksLoop) {
+  auto ret = main_loop<2>(100, 10, {.seed = 42, .verify = true, .leaf_size = 16});
+  ASSERT_EQ(ret, 0);
+}
+
+TEST(WalkTreeTest, LazyMatchesEager) {
+  std::random_device rd;
+  auto seed = rd();
+
+  for (int leaf_size : {1, 16}) {
+    walk_tree<3> eager(500, seed, true, leaf_size);
+    walk_tree<3> lazy(500, seed, true, leaf_size);
+    lazy.set_rebalance_slack(3);
+    int max_height = std::bit_width(static_cast<unsigned int>((500 + leaf_size - 1) / leaf_size - 1)) + 3;
+    for (int i = 0; i < 1000; ++i) {
+      ASSERT_EQ(eager.rand_pivot(), lazy.rand_pivot());
+      ASSERT_LE(lazy.root()->height(), max_height);
+    }
+    EXPECT_EQ(eager.steps(), lazy.steps());
+    for (int n = leaf_size; n < 500; n += leaf_size) {
+      EXPECT_EQ(lazy.find_node(n).id(), n);
+    }
+
+    lazy.set_rebalance_slack(0);
+    for (int i = 0; i < 200; ++i) {
+      ASSERT_EQ(eager.rand_pivot(), lazy.rand_pivot());
+      ASSERT_EQ(lazy.root()->height(), eager.root()->height());
+    }
+    EXPECT_EQ(eager.steps(), lazy.steps());
+    EXPECT_TRUE(lazy.self_avoiding());
+    EXPECT_THROW(lazy.set_rebalance_slack(-1), std::invalid_argument);
+  }
+}
+
+TEST(WalkTreeTest, LazyLoop) {
+  auto ret = main_loop<2>(100, 10, {.seed = 42, .verify = true, .rebalance_slack = 2});
+  ASSERT_EQ(ret, 0);
+}
+
+TEST(WalkTreeTest, SiteQueries) {
+  std::random_device rd;
+  auto seed = rd();
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> dist(0, 500);
+
+  for (int leaf_size : {1, 16}) {
+    walk_tree<3> w(500, seed, true, leaf_size);
+    w.set_rebalance_slack(2);
+    for (int i = 0; i < 1000; ++i) {
+      w.rand_pivot();
+    }
+    auto steps = w.steps();
+    auto expected_bbox = [&steps](int i, int j) {
+      std::array<interval, 3> intervals;
+      for (int k = 0; k < 3; ++k) {
+        auto [min, max] = std::minmax_element(steps.begin() + i, steps.begin() + j,
+                                              [k](const point<3> &p, const point<3> &q) { return p[k] < q[k]; });
+        intervals[k] = interval((*min)[k], (*max)[k]);
+      }
+      return box<3>(intervals);
+    };
+
+    for (int i = 0; i < 500; ++i) {
+      ASSERT_EQ(w.site(i), steps[i]);
+    }
+    for (int n = 0; n < 100; ++n) {
+      int i = dist(gen);
+      int j = dist(gen);
+      if (i != j) {
+        ASSERT_EQ(w.bbox(std::min(i, j), std::max(i, j)), expected_bbox(std::min(i, j), std::max(i, j)));
+      }
+    }
+    EXPECT_EQ(w.bbox(0, 500), w.root()->bbox());
+
+    std::vector<int> indices;
+    for (int i = 0; i < 500; i += 1 + dist(gen) % 20) {
+      indices.push_back(i);
+    }
+    auto sites = w.sites(indices);
+    ASSERT_EQ(sites.size(), indices.size());
+    for (std::size_t k = 0; k < indices.size(); ++k) {
+      EXPECT_EQ(sites[k], steps[indices[k]]);
+    }
+    indices.push_back(500);
+    auto boxes = w.bboxes(indices);
+    ASSERT_EQ(boxes.size(), indices.size() - 1);
+    for (std::size_t k = 0; k + 1 < indices.size(); ++k) {
+      EXPECT_EQ(boxes[k], expected_bbox(indices[k], indices[k + 1]));
+    }
+
+    EXPECT_THROW(w.site(500), std::invalid_argument);
+    EXPECT_THROW(w.bbox(3, 3), std::invalid_argument);
+    EXPECT_THROW(w.sites(std::vector{2, 1}), std::invalid_argument);
+    EXPECT_THROW(w.bboxes(std::vector{0, 2, 2}), std::invalid_argument);
+  }
+}
+
+TEST(DimerizeTest, SelfAvoiding) {
+  auto seed = std::random_device{}();
+  for (int num_sites : {2, 16, 17, 100, 1000}) {
+    auto steps = pseudo_dimerize<2, false>(num_sites, seed);
+    ASSERT_EQ(steps.size(), num_sites);
+    EXPECT_EQ(steps[0], (point<2>::unit(0)));
+    auto w = walk_tree<2>(steps, seed);
+    EXPECT_TRUE(w.self_avoiding());
+  }
+  // in one dimension, the only self-avoiding walks are straight lines
+  auto steps = pseudo_dimerize<1, false>(100, seed);
+  EXPECT_EQ(std::abs(steps.back()[0] - steps[0][0]), 99);
+}
+
+TEST(DimerizeTest, ParallelMatchesSerial) {
+  auto seed = std::random_device{}();
+  // long enough for the halves of the top levels to be built by separate threads
+  auto serial = pseudo_dimerize<3, false>(300000, seed);
+  EXPECT_EQ(serial, (pseudo_dimerize<3, false>(300000, seed, 3)));
+  EXPECT_NE(serial, (pseudo_dimerize<3, false>(300000, seed + 1)));
+  // self_avoiding compares all pairs of sites, which takes too long for this many
+  std::unordered_set<point<3>, point_hash> sites(serial.size(), point_hash(serial.size()));
+  for (int i = 0; i < static_cast<int>(serial.size()); ++i) {
+    ASSERT_TRUE(sites.insert(serial[i]).second);
+    if (i > 0) {
+      auto diff = serial[i] - serial[i - 1];
+      ASSERT_EQ(std::abs(diff[0]) + std::abs(diff[1]) + std::abs(diff[2]), 1);
+    }
+  }
+}
+
+TEST(DimerizeTest, Loop) {
+  auto ret = main_loop<3>(1000, 100, {.seed = 42, .verify = true, .num_workers = 2, .dimerize = true});
+  ASSERT_EQ(ret, 0);
+  ret = main_loop<3>(1000, 100, {.naive = true, .seed = 42, .verify = true, .dimerize = true});
+  ASSERT_EQ(ret, 0);
+}
+
+TEST(SampleSinkTest, Decimation) {
+  auto path = testing::TempDir() + "samples.csv";
+  {
+    file_sink<2> sink(path, false, 3);
+    for (int i = 0; i < 10; ++i) {
+      sink.push(point<2>({i, -i}));
+    }
+  }
+  auto samples = from_csv<2, false>(path);
+  ASSERT_EQ(samples.size(), 4);
+  for (int k = 0; k < 4; ++k) {
+    EXPECT_EQ(samples[k], point<2>({3 * k, -3 * k}));
+  }
+}
+
+TEST(SampleSinkTest, Binary) {
+  // small buffers, so that the writer thread handles many of them
+  auto path = testing::TempDir() + "samples.bin";
+  sample_writer writer(path, 3, true, 1, 4);
+  for (int i = 0; i < 1000; ++i) {
+    std::array<int, 3> row{i, 2 * i, -i};
+    writer.push(row.data());
+  }
+  writer.close();
+
+  std::ifstream file(path, std::ios::binary);
+  std::vector<int> rows(3000);
+  file.read(reinterpret_cast<char *>(rows.data()), rows.size() * sizeof(int));
+  ASSERT_EQ(file.gcount(), rows.size() * sizeof(int));
+  EXPECT_EQ(file.peek(), EOF);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(rows[3 * i], i);
+    EXPECT_EQ(rows[3 * i + 1], 2 * i);
+    EXPECT_EQ(rows[3 * i + 2], -i);
+  }
+}
+
+TEST(WalkTreeTest, LoopStreamsEndpoints) {
+  auto ret = main_loop<2>(100, 10,
+                          {.seed = 42, .require_success = true, .out_dir = testing::TempDir(), .sample_every = 2});
   ASSERT_EQ(ret, 0);
+  EXPECT_EQ((from_csv<2, false>(testing::TempDir() + "/endpoints.csv").size()), 5);
 }
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dispatch.h"
+#include "lattice.h"
+#include "lattice_simd.h"
+#include "philox.h"
+#include "proposals.h"
+#include "walk.h"
+#include "walk_tree.h"
+
+// This file is compiled with AVX2 flags and only runs on CPUs that support them.
+
+using namespace pivot;
+
+// helpers get internal linkage, so that no other unit can end up with their copies
+namespace {
+
+class Avx2Test : public testing::Test {
+protected:
+    void SetUp() override {
+        if (!simd_supported(2)) {
+            GTEST_SKIP() << "AVX2 not supported by this CPU";
+        }
+    }
+};
+
+template <int Dim> void expect_simd_group_matches() {
+    std::vector<std::pair<transform<Dim>, transform<Dim, true>>> elements;
+    std::array<int, Dim> perm;
+    for (int i = 0; i < Dim; ++i) {
+        perm[i] = i;
+    }
+    do {
+        for (int bits = 0; bits < (1 << Dim); ++bits) {
+            std::array<int, Dim> signs;
+            for (int i = 0; i < Dim; ++i) {
+                signs[i] = bits & (1 << i) ? -1 : 1;
+            }
+            elements.emplace_back(transform<Dim>(perm, signs), transform<Dim, true>(perm, signs));
+        }
+    } while (std::next_permutation(perm.begin(), perm.end()));
+    ASSERT_TRUE(elements[0].second.is_identity());
+
+    std::array<int, Dim> coords;
+    std::array<interval, Dim> intervals;
+    for (int i = 0; i < Dim; ++i) {
+        coords[i] = i + 1;
+        intervals[i] = interval{-i, 2 * i + 1};
+    }
+    auto p = point<Dim>(coords);
+    auto p_simd = point<Dim, true>(coords);
+    auto b = box<Dim>(intervals);
+    auto b_simd = box<Dim, true>(intervals);
+    for (const auto &[t1, t1_simd] : elements) {
+        EXPECT_EQ(t1_simd.to_string(), t1.to_string());
+        EXPECT_EQ((t1_simd * p_simd).to_string(), (t1 * p).to_string());
+        EXPECT_EQ((t1_simd * b_simd).to_string(), (t1 * b).to_string());
+        EXPECT_EQ(t1_simd.inverse().to_string(), t1.inverse().to_string());
+        for (const auto &[t2, t2_simd] : elements) {
+            EXPECT_EQ((t1_simd * t2_simd).to_string(), (t1 * t2).to_string());
+        }
+    }
+}
+
+// a walk and its SIMD counterpart, seeded alike, accept the same pivots and end up with the same sites
+template <class Walk, class SimdWalk> void expect_simd_walk_matches(Walk &w, SimdWalk &w_simd, int iters, bool fast) {
+    for (int i = 0; i < iters; ++i) {
+        ASSERT_EQ(w_simd.rand_pivot(fast), w.rand_pivot(fast)) << "iteration " << i;
+    }
+    auto steps = w.steps();
+    auto steps_simd = w_simd.steps();
+    ASSERT_EQ(steps_simd.size(), steps.size());
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        EXPECT_EQ(steps_simd[i].to_string(), steps[i].to_string()) << "site " << i;
+    }
+    EXPECT_TRUE(w_simd.self_avoiding());
+}
+
+} // namespace
+
+TEST_F(Avx2Test, Transform2D) { expect_simd_group_matches<2>(); }
+
+TEST_F(Avx2Test, Transform3D) { expect_simd_group_matches<3>(); }
+
+TEST_F(Avx2Test, Transform4D) { expect_simd_group_matches<4>(); }
+
+TEST_F(Avx2Test, Box3D) {
+    auto p1 = point<3, true>({1, 2, 3});
+    auto p2 = point<3, true>({5, -5, 4});
+    auto b1 = box<3, true>(std::array{p1, p2});
+    EXPECT_EQ(b1, (box<3, true>({interval{1, 5}, interval{-7, 0}, interval{0, 1}})));
+    EXPECT_EQ(b1.to_string(), "[1, 5] x [-7, 0] x [0, 1]");
+
+    box<3, true> b2({interval{3, 6}, interval{-1, 2}, interval{1, 1}});
+    EXPECT_EQ(b1 | b2, (box<3, true>({interval{1, 6}, interval{-7, 2}, interval{0, 1}})));
+    EXPECT_EQ(b1 & b2, (box<3, true>({interval{3, 5}, interval{-1, 0}, interval{1, 1}})));
+    EXPECT_FALSE((b1 & b2).empty());
+    b2 += point<3, true>({0, 0, 1});
+    EXPECT_TRUE((b1 & b2).empty());
+}
+
+TEST_F(Avx2Test, PhiloxFirstBlocks) {
+    // a number of streams that is not a multiple of the number of lanes
+    std::vector<std::array<std::uint64_t, 2>> blocks(21), blocks_simd(21);
+    philox_first_blocks<false>(0x123456789, 5, blocks);
+    philox_first_blocks<true>(0x123456789, 5, blocks_simd);
+    EXPECT_EQ(blocks_simd, blocks);
+}
+
+TEST_F(Avx2Test, ProposalQueue) {
+    proposal_streams streams(42);
+    proposal_queue<3, false> queue(streams, 1, 99);
+    proposal_queue<3, true> queue_simd(streams, 1, 99);
+    for (int k = 0; k < 600; ++k) {
+        const auto &p = queue.next();
+        const auto &p_simd = queue_simd.next();
+        ASSERT_EQ(p_simd.site, p.site) << "proposal " << k;
+        ASSERT_EQ(p_simd.trans.to_string(), p.trans.to_string()) << "proposal " << k;
+    }
+}
+
+TEST_F(Avx2Test, WalkTree2D) {
+    walk_tree<2, false> w(200, 42);
+    walk_tree<2, true> w_simd(200, 42);
+    expect_simd_walk_matches(w, w_simd, 2000, true);
+}
+
+TEST_F(Avx2Test, WalkTree3D) {
+    walk_tree<3, false> w(200, 42);
+    walk_tree<3, true> w_simd(200, 42);
+    expect_simd_walk_matches(w, w_simd, 2000, true);
+}
+
+TEST_F(Avx2Test, WalkTree4D) {
+    walk_tree<4, false> w(200, 42);
+    walk_tree<4, true> w_simd(200, 42);
+    expect_simd_walk_matches(w, w_simd, 2000, true);
+}
+
+TEST_F(Avx2Test, Walk2D) {
+    for (bool fast : {false, true}) {
+        walk<2, false> w(200, 42);
+        walk<2, true> w_simd(200, 42);
+        expect_simd_walk_matches(w, w_simd, 2000, fast);
+    }
+}
+
+TEST_F(Avx2Test, Walk3D) {
+    for (bool fast : {false, true}) {
+        walk<3, false> w(200, 42);
+        walk<3, true> w_simd(200, 42);
+        expect_simd_walk_matches(w, w_simd, 2000, fast);
+    }
+}
@@ -0,0 +1,115 @@
+#include <array>
+#include <cstddef>
+
+#include <gtest/gtest.h>
+
+#include "dispatch.h"
+#include "lattice.h"
+#include "lattice_simd.h"
+#include "philox.h"
+#include "walk.h"
+#include "walk_tree.h"
+
+// This file is compiled with AVX-512 flags and only runs on CPUs that support them.
+
+using namespace pivot;
+
+// helpers get internal linkage, so that no other unit can end up with their copies
+namespace {
+
+class Avx512Test : public testing::Test {
+protected:
+    void SetUp() override {
+        if (!simd_supported(5)) {
+            GTEST_SKIP() << "AVX-512 not supported by this CPU";
+        }
+    }
+};
+
+template <int Dim> void expect_simd_random_matches() {
+    philox gen(42);
+    philox gen_simd(42);
+    std::array<int, Dim> coords;
+    std::array<interval, Dim> intervals;
+    for (int i = 0; i < Dim; ++i) {
+        coords[i] = i + 1;
+        intervals[i] = interval{-i, 2 * i + 1};
+    }
+    auto p = point<Dim>(coords);
+    auto p_simd = point<Dim, true>(coords);
+    auto b = box<Dim>(intervals);
+    auto b_simd = box<Dim, true>(intervals);
+    for (int i = 0; i < 1000; ++i) {
+        auto t1 = transform<Dim>::rand(gen);
+        auto t2 = transform<Dim>::rand(gen);
+        auto t1_simd = transform<Dim, true>::rand(gen_simd);
+        auto t2_simd = transform<Dim, true>::rand(gen_simd);
+        ASSERT_EQ(t1_simd.to_string(), t1.to_string());
+        EXPECT_EQ((t1_simd * p_simd).to_string(), (t1 * p).to_string());
+        EXPECT_EQ((t1_simd * b_simd).to_string(), (t1 * b).to_string());
+        EXPECT_EQ(t1_simd.inverse().to_string(), t1.inverse().to_string());
+        EXPECT_EQ((t1_simd * t2_simd).to_string(), (t1 * t2).to_string());
+        EXPECT_TRUE((t1_simd * t1_simd.inverse()).is_identity());
+    }
+}
+
+// a walk and its SIMD counterpart, seeded alike, accept the same pivots and end up with the same sites
+template <class Walk, class SimdWalk> void expect_simd_walk_matches(Walk &w, SimdWalk &w_simd, int iters, bool fast) {
+    for (int i = 0; i < iters; ++i) {
+        ASSERT_EQ(w_simd.rand_pivot(fast), w.rand_pivot(fast)) << "iteration " << i;
+    }
+    auto steps = w.steps();
+    auto steps_simd = w_simd.steps();
+    ASSERT_EQ(steps_simd.size(), steps.size());
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        EXPECT_EQ(steps_simd[i].to_string(), steps[i].to_string()) << "site " << i;
+    }
+    EXPECT_TRUE(w_simd.self_avoiding());
+}
+
+} // namespace
+
+TEST_F(Avx512Test, Transform5D) { expect_simd_random_matches<5>(); }
+
+TEST_F(Avx512Test, Transform8D) {
+    auto p = point<8, true>({1, 2, 3, 4, 5, 6, 7, 8});
+    box<8, true> b({interval{1, 2}, interval{2, 4}, interval{3, 6}, interval{4, 8}, interval{5, 10}, interval{6, 12},
+                    interval{7, 14}, interval{8, 16}});
+    philox gen(42);
+    for (int i = 0; i < 1000; ++i) {
+        auto t1 = transform<8, true>::rand(gen);
+        auto t2 = transform<8, true>::rand(gen);
+        EXPECT_EQ((t1 * t2) * p, t1 * (t2 * p)) << "t1: " << t1.to_string() << ", t2: " << t2.to_string();
+        EXPECT_EQ((t1 * t2) * b, t1 * (t2 * b)) << "t1: " << t1.to_string() << ", t2: " << t2.to_string();
+        EXPECT_EQ(t1.inverse() * (t1 * p), p) << "t1: " << t1.to_string();
+        EXPECT_EQ(t1.inverse() * (t1 * b), b) << "t1: " << t1.to_string();
+    }
+}
+
+TEST_F(Avx512Test, Box5D) {
+    auto p1 = point<5, true>({1, 2, 3, 4, 5});
+    auto p2 = point<5, true>({5, -5, 4, 4, 0});
+    auto b1 = box<5, true>(std::array{p1, p2});
+    EXPECT_EQ(b1.to_string(), "[1, 5] x [-7, 0] x [0, 1] x [0, 0] x [-5, 0]");
+
+    box<5, true> b2({interval{3, 6}, interval{-1, 2}, interval{1, 1}, interval{0, 0}, interval{-1, 1}});
+    EXPECT_EQ((b1 | b2).to_string(), "[1, 6] x [-7, 2] x [0, 1] x [0, 0] x [-5, 1]");
+    EXPECT_EQ((b1 & b2).to_string(), "[3, 5] x [-1, 0] x [1, 1] x [0, 0] x [-1, 0]");
+    EXPECT_FALSE((b1 & b2).empty());
+    b2 += point<5, true>({0, 0, 0, 0, 2});
+    EXPECT_TRUE((b1 & b2).empty());
+}
+
+TEST_F(Avx512Test, WalkTree5D) {
+    walk_tree<5, false> w(200, 42);
+    walk_tree<5, true> w_simd(200, 42);
+    expect_simd_walk_matches(w, w_simd, 2000, true);
+}
+
+TEST_F(Avx512Test, Walk5D) {
+    for (bool fast : {false, true}) {
+        walk<5, false> w(200, 42);
+        walk<5, true> w_simd(200, 42);
+        expect_simd_walk_matches(w, w_simd, 2000, fast);
+    }
+}
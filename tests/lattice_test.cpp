@@ -1,20 +1,19 @@
+#include <algorithm>
 #include <array>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "lattice.h"
-
-#ifdef ENABLE_AVX2
-#include "lattice_simd.h"
-constexpr bool simd_enabled = true;
-#else
-constexpr bool simd_enabled = false;
-#endif
+#include "philox.h"
+#include "proposals.h"
 
 using namespace pivot;
 
 TEST(PointTest, ToString) {
-    auto p = point<2, simd_enabled>({1, 2});
+    auto p = point<2>({1, 2});
     EXPECT_EQ(p.to_string(), "(1, 2)");
     auto q = point<1>({3});
     EXPECT_EQ(q.to_string(), "(3,)");
@@ -51,28 +50,28 @@ TEST(BoxTest, FromSpan1D) {
 }
 
 TEST(BoxTest, FromSpan2D) {
-    auto p1 = point<2, simd_enabled>({1, 2});
-    auto b1 = box<2, simd_enabled>(std::array{p1});
+    auto p1 = point<2>({1, 2});
+    auto b1 = box<2>(std::array{p1});
     EXPECT_EQ(b1.intervals()[0].left_, 1);
     EXPECT_EQ(b1.intervals()[0].right_, 1);
     EXPECT_EQ(b1.intervals()[1].left_, 0);
     EXPECT_EQ(b1.intervals()[1].right_, 0);
 
-    auto p2 = point<2, simd_enabled>({5, 5});
-    auto b2 = box<2, simd_enabled>(std::array{p1, p2});
+    auto p2 = point<2>({5, 5});
+    auto b2 = box<2>(std::array{p1, p2});
     EXPECT_EQ(b2.intervals()[0].left_, 1);
     EXPECT_EQ(b2.intervals()[0].right_, 5);
     EXPECT_EQ(b2.intervals()[1].left_, 0);
     EXPECT_EQ(b2.intervals()[1].right_, 3);
 
-    auto b3 = box<2, simd_enabled>(std::array{p2, p1});
+    auto b3 = box<2>(std::array{p2, p1});
     EXPECT_EQ(b3.intervals()[0].left_, -3);
     EXPECT_EQ(b3.intervals()[0].right_, 1);
     EXPECT_EQ(b3.intervals()[1].left_, -3);
     EXPECT_EQ(b3.intervals()[1].right_, 0);
 
-    auto p3 = point<2, simd_enabled>({3, 4});
-    auto b4 = box<2, simd_enabled>(std::array{p1, p2, p3});
+    auto p3 = point<2>({3, 4});
+    auto b4 = box<2>(std::array{p1, p2, p3});
     EXPECT_EQ(b4.intervals()[0].left_, 1);
     EXPECT_EQ(b4.intervals()[0].right_, 5);
     EXPECT_EQ(b4.intervals()[1].left_, 0);
@@ -98,15 +97,15 @@ TEST(BoxTest, Union1D) {
 }
 
 TEST(BoxTest, Union2D) {
-    box<2, simd_enabled> b1({interval{-1, 1}, interval{0, 1}});
-    box<2, simd_enabled> b2({interval{0, 2}, interval{0, 2}});
+    box<2> b1({interval{-1, 1}, interval{0, 1}});
+    box<2> b2({interval{0, 2}, interval{0, 2}});
     auto b3 = b1 | b2;
     EXPECT_EQ(b3.intervals()[0].left_, -1);
     EXPECT_EQ(b3.intervals()[0].right_, 2);
     EXPECT_EQ(b3.intervals()[1].left_, 0);
     EXPECT_EQ(b3.intervals()[1].right_, 2);
 
-    box<2, simd_enabled> b4({interval{2, 3}, interval{1, 2}});
+    box<2> b4({interval{2, 3}, interval{1, 2}});
     auto b5 = b1 | b4;
     EXPECT_EQ(b5.intervals()[0].left_, -1);
     EXPECT_EQ(b5.intervals()[0].right_, 3);
@@ -132,36 +131,47 @@ TEST(BoxTest, Intersection1D) {
 }
 
 TEST(BoxTest, Intersection2D) {
-    box<2, simd_enabled> b1({interval{-1, 1}, interval{0, 1}});
-    box<2, simd_enabled> b2({interval{0, 2}, interval{0, 2}});
+    box<2> b1({interval{-1, 1}, interval{0, 1}});
+    box<2> b2({interval{0, 2}, interval{0, 2}});
     auto b3 = b1 & b2;
     EXPECT_EQ(b3.intervals()[0].left_, 0);
     EXPECT_EQ(b3.intervals()[0].right_, 1);
     EXPECT_EQ(b3.intervals()[1].left_, 0);
     EXPECT_EQ(b3.intervals()[1].right_, 1);
 
-    box<2, simd_enabled> b4({interval{2, 3}, interval{1, 2}});
+    box<2> b4({interval{2, 3}, interval{1, 2}});
     auto b5 = b1 & b4;
     EXPECT_TRUE(b5.empty());
 }
 
+TEST(BoxTest, Disjoint2D) {
+    box<2> b1({interval{-1, 1}, interval{0, 1}});
+    box<2> b2({interval{0, 2}, interval{0, 2}});
+    box<2> b3({interval{2, 3}, interval{1, 2}});
+    box<2> b4({interval{-1, 1}, interval{2, 3}});
+    EXPECT_EQ(b1.disjoint(b2, b3), (std::array{false, true}));
+    EXPECT_EQ(b1.disjoint(b3, b2), (std::array{true, false}));
+    EXPECT_EQ(b1.disjoint(b3, b4), (std::array{true, true}));
+    EXPECT_EQ(b1.disjoint(b1, b2), (std::array{false, false}));
+}
+
 TEST(BoxTest, ToString) {
     box<1> b1({interval{-1, 1}});
     EXPECT_EQ(b1.to_string(), "[-1, 1]");
 
-    box<2, simd_enabled> b2({interval{-1, 1}, interval{0, 1}});
+    box<2> b2({interval{-1, 1}, interval{0, 1}});
     EXPECT_EQ(b2.to_string(), "[-1, 1] x [0, 1]");
 }
 
 TEST(TransformTest, Pivot2D) {
-    auto e0 = point<2, simd_enabled>::unit(0);
+    auto e0 = point<2>::unit(0);
 
-    point<2, simd_enabled> p1({3, 4});
-    point<2, simd_enabled> p2({4, 4});
+    point<2> p1({3, 4});
+    point<2> p2({4, 4});
     transform t1(p1, p2);
     EXPECT_EQ(p1 + t1 * e0, p2);
 
-    point<2, simd_enabled> p3({3, 5});
+    point<2> p3({3, 5});
     transform t2(p1, p3);
     EXPECT_EQ(p1 + t2 * e0, p3);
 }
@@ -180,10 +190,10 @@ TEST(TransformTest, Pivot3D) {
 }
 
 TEST(TransformTest, Compose2D) {
-    auto t1 = transform<2, simd_enabled>::rand();
-    auto t2 = transform<2, simd_enabled>::rand();
+    auto t1 = transform<2>::rand();
+    auto t2 = transform<2>::rand();
     auto t3 = t1 * t2;
-    auto p = point<2, simd_enabled>({1, 2});
+    auto p = point<2>({1, 2});
     EXPECT_EQ(t3 * p, t1 * (t2 * p)) << "t1: " << t1.to_string() << ", t2: " << t2.to_string();
 }
 
@@ -195,17 +205,58 @@ TEST(TransformTest, Compose3D) {
     EXPECT_EQ(t3 * p, t1 * (t2 * p)) << "t1: " << t1.to_string() << ", t2: " << t2.to_string();
 }
 
+TEST(TransformTest, Group3D) {
+    std::vector<transform<3>> elements;
+    std::array<int, 3> perm = {0, 1, 2};
+    do {
+        for (int bits = 0; bits < 8; ++bits) {
+            elements.push_back(transform<3>(perm, {bits & 1 ? -1 : 1, bits & 2 ? -1 : 1, bits & 4 ? -1 : 1}));
+        }
+    } while (std::next_permutation(perm.begin(), perm.end()));
+    ASSERT_TRUE(elements[0].is_identity());
+
+    // a point with distinct absolute coordinates determines the transform applied to it
+    auto p = point<3>({1, 2, 3});
+    for (const auto &t1 : elements) {
+        EXPECT_EQ(t1.inverse() * (t1 * p), p) << "t1: " << t1.to_string();
+        EXPECT_TRUE((t1 * t1.inverse()).is_identity()) << "t1: " << t1.to_string();
+        for (const auto &t2 : elements) {
+            EXPECT_EQ((t1 * t2) * p, t1 * (t2 * p)) << "t1: " << t1.to_string() << ", t2: " << t2.to_string();
+        }
+    }
+}
+
+TEST(TransformTest, Group4D) {
+    std::vector<transform<4>> elements;
+    std::array<int, 4> perm = {0, 1, 2, 3};
+    do {
+        for (int bits = 0; bits < 16; ++bits) {
+            elements.push_back(transform<4>(
+                perm, {bits & 1 ? -1 : 1, bits & 2 ? -1 : 1, bits & 4 ? -1 : 1, bits & 8 ? -1 : 1}));
+        }
+    } while (std::next_permutation(perm.begin(), perm.end()));
+    ASSERT_TRUE(elements[0].is_identity());
+
+    auto p = point<4>({1, 2, 3, 4});
+    for (const auto &t1 : elements) {
+        EXPECT_EQ(t1.inverse() * (t1 * p), p) << "t1: " << t1.to_string();
+        for (const auto &t2 : elements) {
+            EXPECT_EQ((t1 * t2) * p, t1 * (t2 * p)) << "t1: " << t1.to_string() << ", t2: " << t2.to_string();
+        }
+    }
+}
+
 TEST(TransformTest, Box2D) {
-    box<2, simd_enabled> b({interval{1, 5}, interval{2, 4}});
+    box<2> b({interval{1, 5}, interval{2, 4}});
 
-    point<2, simd_enabled> p1({0, 0});
-    point<2, simd_enabled> p2({0, 1});
-    transform<2, simd_enabled> t1(p1, p2);
-    auto result1 = box<2, simd_enabled>({interval{-4, -2}, interval{1, 5}});
+    point<2> p1({0, 0});
+    point<2> p2({0, 1});
+    transform<2> t1(p1, p2);
+    auto result1 = box<2>({interval{-4, -2}, interval{1, 5}});
     EXPECT_EQ(t1 * b, result1);
 
-    transform<2, simd_enabled> t2({0, 1}, {-1, 1});
-    auto result2 = box<2, simd_enabled>({interval{-5, -1}, interval{2, 4}});
+    transform<2> t2({0, 1}, {-1, 1});
+    auto result2 = box<2>({interval{-5, -1}, interval{2, 4}});
     EXPECT_EQ(t2 * b, result2);
 }
 
@@ -225,15 +276,15 @@ TEST(TransformTest, Box3D) {
 }
 
 TEST(TransformTest, Inverse2D) {
-    transform<2, simd_enabled> id({0, 1}, {1, 1});
-    auto o = point<2, simd_enabled>({0, 0});
-    auto e1 = point<2, simd_enabled>({1, 0});
-    auto e2 = point<2, simd_enabled>({0, 1});
+    transform<2> id({0, 1}, {1, 1});
+    auto o = point<2>({0, 0});
+    auto e1 = point<2>({1, 0});
+    auto e2 = point<2>({0, 1});
     ASSERT_EQ(e1, id * e1);
     ASSERT_EQ(e2, id * e2);
 
-    transform<2, simd_enabled> t({1, 0}, {-1, 1});
-    transform<2, simd_enabled> t_inv = t.inverse();
+    transform<2> t({1, 0}, {-1, 1});
+    transform<2> t_inv = t.inverse();
     auto f1 = t * e1;
     auto f2 = t * e2;
     ASSERT_EQ(f1, e2);
@@ -265,3 +316,71 @@ TEST(TransformTest, Inverse3D) {
     EXPECT_EQ(e2, t_inv * f2);
     EXPECT_EQ(e3, t_inv * f3);
 }
+
+TEST(TransformTest, RandCoversGroup3D) {
+    // 48 elements drawn uniformly: missing one after 10000 draws has probability below 1e-80
+    philox gen(42);
+    std::set<std::string> drawn;
+    for (int i = 0; i < 10000; ++i) {
+        drawn.insert(transform<3>::rand(gen).to_string());
+    }
+    EXPECT_EQ(drawn.size(), 48);
+}
+
+TEST(PhiloxTest, KnownAnswers) {
+    // test vectors of the Random123 library
+    using block = std::array<std::uint32_t, 4>;
+    EXPECT_EQ(philox::block({0, 0, 0, 0}, {0, 0}), (block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(philox::block({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+              (block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    EXPECT_EQ(philox::block({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+              (block{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(PhiloxTest, Streams) {
+    philox gen(42, 7);
+    auto first = philox::block({0, 0, 7, 0}, {42, 0});
+    EXPECT_EQ(gen(), static_cast<std::uint64_t>(first[1]) << 32 | first[0]);
+    EXPECT_EQ(gen(), static_cast<std::uint64_t>(first[3]) << 32 | first[2]);
+    auto second = philox::block({1, 0, 7, 0}, {42, 0});
+    EXPECT_EQ(gen(), static_cast<std::uint64_t>(second[1]) << 32 | second[0]);
+
+    proposal_streams streams(42);
+    streams.next();
+    auto state = streams;
+    EXPECT_EQ(streams.next()(), streams.at(1)());
+    EXPECT_NE(streams.at(1)(), streams.at(2)());
+    state.seek(2);
+    EXPECT_EQ(state, streams);
+
+    // a number of streams that is not a multiple of the number of lanes
+    std::vector<std::array<std::uint64_t, 2>> blocks(21);
+    philox_first_blocks<false>(0x123456789, 5, blocks);
+    for (int i = 0; i < 21; ++i) {
+        philox expected(0x123456789, 5 + i);
+        philox gen(0x123456789, 5 + i, blocks[i]);
+        for (int j = 0; j < 3; ++j) {
+            ASSERT_EQ(gen(), expected()) << "stream " << 5 + i;
+        }
+    }
+}
+
+TEST(ProposalQueueTest, MatchesStreams) {
+    proposal_streams streams(42);
+    proposal_queue<3, false> queue(streams, 1, 99);
+    std::uniform_int_distribution<int> dist(1, 99);
+    auto expect_proposal = [&](std::uint64_t k) {
+        auto gen = streams.at(k);
+        auto site = dist(gen);
+        auto t = transform<3>::rand(gen);
+        const auto &p = queue.next();
+        EXPECT_EQ(p.site, site) << "proposal " << k;
+        EXPECT_EQ(p.trans.to_string(), t.to_string()) << "proposal " << k;
+    };
+    for (std::uint64_t k = 0; k < 600; ++k) {
+        ASSERT_EQ(queue.position(), k);
+        expect_proposal(k);
+    }
+    queue.seek(17);
+    expect_proposal(17);
+}
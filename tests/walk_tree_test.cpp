@@ -1,5 +1,9 @@
+#include <cstdint>
+#include <fstream>
+
 #include <gtest/gtest.h>
 
+#include "utils.h"
 #include "walk_node.h"
 #include "walk_tree.h"
 
@@ -71,3 +75,121 @@ TEST(WalkTreePivot, PivotLineFail) {
     EXPECT_EQ(steps[1], pivot::point<2>({2, 0}));
     EXPECT_EQ(steps[2], pivot::point<2>({3, 0}));
 }
+
+TEST(WalkTreeInit, LeafBlocks) {
+    pivot::walk_tree<2> w1(200);
+    for (size_t i = 0; i < 200; ++i) {
+        w1.rand_pivot();
+    }
+
+    auto steps1 = w1.steps();
+    for (int leaf_size : {2, 3, 16, 64}) {
+        pivot::walk_tree<2> w2(steps1, std::nullopt, true, leaf_size);
+        EXPECT_EQ(w2.steps(), steps1);
+        EXPECT_EQ(w2.endpoint(), steps1.back());
+        for (int i = leaf_size; i < 200; i += leaf_size) {
+            EXPECT_EQ(w2.find_node(i).id(), i);
+        }
+    }
+    EXPECT_THROW(pivot::walk_tree<2>(steps1, std::nullopt, true, 65), std::invalid_argument);
+    EXPECT_THROW(pivot::walk_tree<2>(steps1, std::nullopt, true, 200), std::invalid_argument);
+    EXPECT_THROW(pivot::walk_tree<2>(steps1, std::nullopt, false, 2), std::invalid_argument);
+}
+
+TEST(WalkTreeInit, BinaryCheckpoint) {
+    pivot::walk_tree<3> w1(300, 42);
+    for (size_t i = 0; i < 300; ++i) {
+        w1.rand_pivot();
+    }
+    auto bin_path = testing::TempDir() + "walk.bin";
+    auto csv_path = testing::TempDir() + "walk.csv";
+    w1.export_bin(bin_path);
+    w1.export_csv(csv_path);
+    EXPECT_TRUE(pivot::is_bin(bin_path));
+    EXPECT_FALSE(pivot::is_bin(csv_path));
+    EXPECT_EQ((pivot::from_bin<3, false>(bin_path).steps), w1.steps());
+    EXPECT_THROW((pivot::from_bin<2, false>(bin_path)), std::runtime_error);
+    EXPECT_THROW((pivot::from_bin<3, false>(csv_path)), std::runtime_error);
+
+    // the format is detected from the contents, and the random engine is restored unless a seed is given
+    pivot::walk_tree<3> w2(bin_path);
+    pivot::walk_tree<3> w3(bin_path);
+    pivot::walk_tree<3> w4(csv_path, 1);
+    EXPECT_EQ(w2.steps(), w1.steps());
+    EXPECT_EQ(w4.steps(), w1.steps());
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(w2.rand_pivot(), w3.rand_pivot());
+    }
+    EXPECT_EQ(w2.steps(), w3.steps());
+
+    auto steps = std::vector{pivot::point<2>({1, 0}), pivot::point<2>({2, 1})};
+    EXPECT_THROW(pivot::to_bin(bin_path, steps), std::invalid_argument);
+}
+
+TEST(WalkTreeInit, BinaryCheckpointVersion) {
+    auto path = testing::TempDir() + "walk_v1.bin";
+    pivot::walk_tree<2>(100, 42).export_bin(path);
+    {
+        // the version follows the 8-byte magic string; version 1 held the state of a std::mt19937 engine
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        std::uint32_t version = 1;
+        file.seekp(8);
+        file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    }
+    EXPECT_TRUE(pivot::is_bin(path));
+    EXPECT_THROW((pivot::from_bin<2, false>(path)), std::runtime_error);
+    EXPECT_THROW(pivot::walk_tree<2>{path}, std::runtime_error);
+}
+
+TEST(WalkTreePivot, LeafBlocksLine) {
+    // on a line, every leaf and node has the identity as its frame, so the pivot transform applies as is
+    auto rotate = transform<2>({1, 0}, {1, -1});
+    auto reflect = transform<2>({0, 1}, {-1, 1});
+    for (bool fast : {false, true}) {
+        for (int n = 1; n < 30; ++n) {
+            auto w = walk_tree<2>(30, std::nullopt, true, 7);
+            if (n > 1) {
+                EXPECT_FALSE(fast ? w.try_pivot_fast(n, reflect) : w.try_pivot(n, reflect));
+                EXPECT_EQ(w.steps(), (line<2, false>(30)));
+            }
+
+            EXPECT_TRUE(fast ? w.try_pivot_fast(n, rotate) : w.try_pivot(n, rotate));
+            auto steps = w.steps();
+            for (int i = 0; i < 30; ++i) {
+                auto expected = i < n ? pivot::point<2>({i + 1, 0}) : pivot::point<2>({n, n - 1 - i});
+                EXPECT_EQ(steps[i], expected) << "pivot site: " << n << ", site: " << i;
+            }
+            EXPECT_EQ(w.endpoint(), steps.back());
+        }
+    }
+}
+
+TEST(WalkTreePivot, Observables) {
+    for (int leaf_size : {1, 16}) {
+        for (int slack : {0, 3}) {
+            pivot::walk_tree<3> w(300, std::nullopt, true, leaf_size);
+            w.set_rebalance_slack(slack);
+            for (int i = 0; i < 200; ++i) {
+                w.rand_pivot(i % 2 == 0);
+                auto steps = w.steps();
+                double n = steps.size();
+                std::array<double, 3> mean{};
+                for (const auto &p : steps) {
+                    for (int j = 0; j < 3; ++j) {
+                        mean[j] += p[j] / n;
+                    }
+                }
+                double rg2 = 0;
+                double end2 = 0;
+                for (const auto &p : steps) {
+                    for (int j = 0; j < 3; ++j) {
+                        rg2 += (p[j] - mean[j]) * (p[j] - mean[j]) / n;
+                        end2 += (p[j] - steps.back()[j]) * (p[j] - steps.back()[j]) / n;
+                    }
+                }
+                ASSERT_NEAR(w.squared_radius_of_gyration(), rg2, 1e-6 * rg2);
+                ASSERT_NEAR(w.mean_squared_distance_to_endpoint(), end2, 1e-6 * end2);
+            }
+        }
+    }
+}